@@ -0,0 +1,240 @@
+/*
+ * Author: Nate Shaffer
+ * Email: nshaffe4@u.rochester.edu
+ * Date Created: 10/18/2026
+ *
+ * Asset manager, loads models and textures in the background and fills them into the scene as they finish
+ */
+
+#include <chrono>
+#include "assets.h"
+
+using namespace std;
+using namespace nsGraphics;
+
+static bool fileExists(const string &fileName) {
+	ifstream file(fileName);
+	return file.good();
+}
+
+AssetManager::AssetManager(int numThreads) : pool(numThreads), placeholder(0, {}, {}, {}, {}) {}
+
+shared_future<Object> AssetManager::loadObject(const string &fileName) {
+	// the same file may be wanted both quantized and not, so each format is cached separately
+	unordered_map<string, shared_future<Object>> &loaded = meshes[compactVertices ? 1 : 0];
+	auto found = loaded.find(fileName);
+	if (found != loaded.end()) {
+		return found->second;
+	}
+
+	shared_future<Object> mesh = pool.submit([fileName, compact = compactVertices] {
+		if (!fileExists(fileName)) {
+			cerr << "Could not open model " << fileName << endl;
+		}
+		Object object(fileName.c_str());
+		if (compact) {
+			object.quantize();
+		}
+		return object;
+	}).share();
+	loaded[fileName] = mesh;
+	return mesh;
+}
+
+shared_future<Texture> AssetManager::loadTexture(const string &fileName) {
+	auto found = textures.find(fileName);
+	if (found != textures.end()) {
+		return found->second;
+	}
+
+	shared_future<Texture> texture = pool.submit([fileName] {
+		// a missing file falls back to the default texture rather than reading garbage dimensions
+		if (!fileExists(fileName)) {
+			cerr << "Could not open texture " << fileName << endl;
+			return Texture();
+		}
+		return Texture(fileName.c_str());
+	}).share();
+	textures[fileName] = texture;
+	return texture;
+}
+
+int AssetManager::addObject(Scene &scene, const string &meshFile, const string &textureFile) {
+	int index = (int) scene.objects.size();
+	scene.objects.push_back(placeholder);
+	pending.push_back({index, loadObject(meshFile), loadTexture(textureFile)});
+	return index;
+}
+
+int AssetManager::populate(Scene &scene) {
+	auto isReady = [](const auto &future) {
+		return future.wait_for(chrono::seconds(0)) == future_status::ready;
+	};
+
+	int added = 0;
+	for (size_t i = 0; i < pending.size();) {
+		PendingObject &p = pending[i];
+		if (!isReady(p.mesh) || !isReady(p.texture)) {
+			i++;
+			continue;
+		}
+
+		// keep whatever transform and settings the placeholder has been given in the meantime
+		Object &slot = scene.objects[p.index];
+		Object loaded = p.mesh.get();
+		loaded.texture = p.texture.get();
+		loaded.offset = slot.offset;
+		loaded.rotation = slot.rotation;
+		loaded.scale = slot.scale;
+		loaded.shading = slot.shading;
+		slot = std::move(loaded);
+
+		pending[i] = std::move(pending.back());
+		pending.pop_back();
+		added++;
+	}
+	return added;
+}
+
+bool AssetManager::loadScene(const string &fileName, Scene &scene) {
+	ifstream file(fileName);
+	if (!file) {
+		cerr << "Could not open scene " << fileName << endl;
+		return false;
+	}
+
+	auto degrees = [](float angle) { return angle * (float) M_PI / 180; };
+
+	string line;
+	int lineNumber = 0;
+	bool hasLights = false;
+	while (getline(file, line)) {
+		lineNumber++;
+		stringstream lineStream(line);
+		string type;
+		if (!(lineStream >> type) || type[0] == '#') {
+			continue;
+		}
+
+		bool valid;
+		if (type == "camera") {
+			float x, y, z, yaw, pitch, fov;
+			valid = (bool) (lineStream >> x >> y >> z >> yaw >> pitch >> fov);
+			if (valid) {
+				scene.camera = Camera(float3(x, y, z), Rotation(degrees(yaw), degrees(pitch)), degrees(fov));
+			}
+		} else if (type == "node" || type == "object") {
+			string name, parentName, meshFile, textureFile;
+			float x, y, z, yaw, pitch, scale;
+			valid = (bool) (lineStream >> name >> parentName >> x >> y >> z >> yaw >> pitch >> scale);
+			if (type == "object") {
+				valid = valid && (lineStream >> meshFile >> textureFile);
+			}
+
+			int parent = parentName == "-" ? -1 : scene.graph.find(parentName);
+			if (valid && parent < 0 && parentName != "-") {
+				cerr << fileName << ":" << lineNumber << ": unknown parent " << parentName << endl;
+				return false;
+			}
+			if (valid) {
+				Transform local(float3(x, y, z), Rotation(degrees(yaw), degrees(pitch)), scale);
+				int node = scene.graph.addNode(name, parent, local);
+				if (type == "object") {
+					scene.graph.attach(node, addObject(scene, meshFile, textureFile));
+				}
+			}
+		} else if (type == "spin") {
+			string name;
+			float rate;
+			valid = (bool) (lineStream >> name >> rate);
+			int node = scene.graph.find(name);
+			if (valid && node < 0) {
+				cerr << fileName << ":" << lineNumber << ": unknown node " << name << endl;
+				return false;
+			}
+			if (valid) {
+				scene.graph.setSpin(node, rate);
+			}
+		} else if (type == "light") {
+			// colors are given as red, green, blue but stored in texture channel order
+			string kind;
+			float x, y, z, r, g, b;
+			lineStream >> kind;
+			valid = (bool) (lineStream >> x >> y >> z);
+			Light light = Light::directional(float3(0, 0, 1), float3());
+			if (kind == "directional") {
+				valid = valid && (lineStream >> r >> g >> b);
+				light = Light::directional(float3(x, y, z), float3(b, g, r));
+			} else if (kind == "point") {
+				float range;
+				valid = valid && (lineStream >> r >> g >> b >> range);
+				light = Light::point(float3(x, y, z), float3(b, g, r), range);
+			} else if (kind == "spot") {
+				float dx, dy, dz, range, inner, outer;
+				valid = valid && (lineStream >> dx >> dy >> dz >> r >> g >> b >> range >> inner >> outer);
+				light = Light::spot(float3(x, y, z), float3(dx, dy, dz), float3(b, g, r), range, degrees(inner),
+									degrees(outer));
+			} else {
+				valid = false;
+			}
+
+			// the first light in the file replaces the scene's default light
+			if (valid) {
+				if (!hasLights) {
+					scene.lights.clear();
+					hasLights = true;
+				}
+				scene.lights.push_back(light);
+			}
+		} else if (type == "ambient") {
+			float r, g, b;
+			valid = (bool) (lineStream >> r >> g >> b);
+			if (valid) {
+				scene.ambient = float3(b, g, r);
+			}
+		} else if (type == "shading") {
+			string name, mode;
+			valid = (bool) (lineStream >> name >> mode) && (mode == "gouraud" || mode == "pixel");
+			int node = scene.graph.find(name);
+			int objectIndex = node < 0 ? -1 : scene.graph.object(node);
+			if (valid && objectIndex < 0) {
+				cerr << fileName << ":" << lineNumber << ": unknown object " << name << endl;
+				return false;
+			}
+			if (valid) {
+				scene.objects[objectIndex].shading = mode == "gouraud" ? ShadingMode::Gouraud : ShadingMode::PerPixel;
+			}
+		} else if (type == "vertices") {
+			// applies to meshes loaded after this entry
+			string format;
+			valid = (bool) (lineStream >> format) && (format == "compact" || format == "full");
+			if (valid) {
+				compactVertices = format == "compact";
+			}
+		} else {
+			cerr << fileName << ":" << lineNumber << ": unknown entry " << type << endl;
+			return false;
+		}
+
+		if (!valid) {
+			cerr << fileName << ":" << lineNumber << ": malformed " << type << " entry" << endl;
+			return false;
+		}
+	}
+
+	// place the new objects before the first frame is drawn
+	scene.graph.update(scene.objects);
+	return true;
+}
+
+bool AssetManager::loading() const {
+	return !pending.empty();
+}
+
+void AssetManager::finish(Scene &scene) {
+	for (PendingObject &p: pending) {
+		p.mesh.wait();
+		p.texture.wait();
+	}
+	populate(scene);
+}
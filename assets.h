@@ -0,0 +1,60 @@
+//
+// Created by nates on 10/18/2026.
+//
+
+#ifndef RENDERINGPROJECT_ASSETS_H
+#define RENDERINGPROJECT_ASSETS_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <future>
+
+#include "scenes.h"
+#include "threadpool.h"
+
+namespace nsGraphics {
+
+	// loads meshes and textures concurrently on a worker pool. Objects added through the manager get their slot in
+	// the scene right away, filled by a placeholder until populate() swaps in the loaded data
+	class AssetManager {
+		struct PendingObject {
+			int index;
+			std::shared_future<Object> mesh;
+			std::shared_future<Texture> texture;
+		};
+
+		ThreadPool pool;
+		std::unordered_map<std::string, std::shared_future<Object>> meshes[2];		// by file, full then compact
+		std::unordered_map<std::string, std::shared_future<Texture>> textures;
+		std::vector<PendingObject> pending;
+
+	public:
+		Object placeholder;		// drawn in place of objects that are still loading, empty by default
+		bool compactVertices = false;	// quantize meshes as they load, see Object::quantize
+
+		explicit AssetManager(int numThreads = (int) std::thread::hardware_concurrency());
+
+		// each file is only loaded once per vertex format, later requests share the same result
+		std::shared_future<Object> loadObject(const std::string &fileName);
+
+		std::shared_future<Texture> loadTexture(const std::string &fileName);
+
+		// appends a placeholder to the scene and returns its index, set the transform on it as usual
+		int addObject(Scene &scene, const std::string &meshFile, const std::string &textureFile);
+
+		// moves every finished object into its slot in the scene, returns how many were added
+		int populate(Scene &scene);
+
+		// reads a text scene file (see README) into the scene graph and starts loading the objects it references
+		bool loadScene(const std::string &fileName, Scene &scene);
+
+		[[nodiscard]] bool loading() const;
+
+		// blocks until every pending object is loaded, then populates the scene
+		void finish(Scene &scene);
+	};
+
+}
+
+#endif //RENDERINGPROJECT_ASSETS_H
@@ -0,0 +1,322 @@
+/*
+ * Author: Nate Shaffer
+ * Email: nshaffe4@u.rochester.edu
+ * Date Created: 10/18/2026
+ *
+ * Renders an animation across several worker processes, handing out frame ranges over unix domain sockets
+ */
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <utility>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#endif
+
+#include "coordinator.h"
+#include "assets.h"
+#include "output.h"
+
+using namespace std;
+using namespace nsGraphics;
+
+string nsGraphics::frameFileName(const string &output, int frame) {
+	string number = to_string(frame);
+	number.insert(0, max(0, 4 - (int) number.size()), '0');
+	size_t dot = output.find_last_of('.');
+	size_t slash = output.find_last_of('/');
+	if (dot == string::npos || (slash != string::npos && dot < slash)) {
+		return output + number;
+	}
+	return output.substr(0, dot) + number + output.substr(dot);
+}
+
+Coordinator::Coordinator(string executable, RenderJob job, int numWorkers) : job(std::move(job)),
+																			  executable(std::move(executable)),
+																			  workers(max(numWorkers, 1)) {}
+
+#ifndef _WIN32
+
+// sockets are streams, so a message can arrive in pieces
+static bool readAll(int fd, void *data, size_t size) {
+	auto *bytes = (char *) data;
+	while (size > 0) {
+		ssize_t n = read(fd, bytes, size);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		bytes += n;
+		size -= n;
+	}
+	return true;
+}
+
+// MSG_NOSIGNAL so writing to a worker that just died is an error instead of a SIGPIPE
+static bool writeAll(int fd, const void *data, size_t size) {
+	auto *bytes = (const char *) data;
+	while (size > 0) {
+		ssize_t n = send(fd, bytes, size, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		bytes += n;
+		size -= n;
+	}
+	return true;
+}
+
+bool Coordinator::spawn(Worker &worker) {
+	// close on exec, so other workers don't hold this socket open and hide this worker's exit
+	int ends[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, ends) != 0) {
+		return false;
+	}
+
+	vector<string> args = {executable, "--worker", to_string(ends[1]), job.sceneFile, job.output,
+						   to_string(job.width), to_string(job.height), to_string(job.fps)};
+	vector<char *> argv;
+	for (string &arg: args) {
+		argv.push_back(arg.data());
+	}
+	argv.push_back(nullptr);
+
+	pid_t pid = fork();
+	if (pid < 0) {
+		close(ends[0]);
+		close(ends[1]);
+		return false;
+	}
+	if (pid == 0) {
+		fcntl(ends[1], F_SETFD, 0);
+		// argv[0] may only be a name found through PATH, so prefer the path of the running binary
+		execv("/proc/self/exe", argv.data());
+		execvp(executable.c_str(), argv.data());
+		_exit(127);
+	}
+
+	close(ends[1]);
+	worker.pid = pid;
+	worker.socket = ends[0];
+	worker.chunk = {0, 0};
+	return true;
+}
+
+// hands out the next range of frames, sized to take about chunkSeconds on this worker, but never more than an even
+// share of what is left so the last chunks finish together
+void Coordinator::assign(Worker &worker) {
+	worker.chunk = {0, 0};
+	if (pending.empty()) {
+		return;
+	}
+
+	int remaining = 0;
+	for (const ChunkMessage &range: pending) {
+		remaining += range.count;
+	}
+	int count = 1;
+	if (worker.msPerFrame > 0) {
+		count = (int) (chunkSeconds * 1000 / worker.msPerFrame);
+		count = clamp(count, 1, max(1, remaining / (int) workers.size()));
+	}
+
+	ChunkMessage &range = pending.front();
+	ChunkMessage chunk = {range.first, min(count, range.count)};
+	range.first += chunk.count;
+	range.count -= chunk.count;
+	if (range.count == 0) {
+		pending.pop_front();
+	}
+
+	worker.chunk = chunk;
+	if (!writeAll(worker.socket, &chunk, sizeof(chunk))) {
+		workerDied(worker);
+	}
+}
+
+// puts the worker's unfinished frames back at the front of the queue and starts a replacement
+void Coordinator::workerDied(Worker &worker) {
+	if (worker.chunk.count > 0) {
+		pending.push_front(worker.chunk);
+		worker.chunk = {0, 0};
+	}
+	close(worker.socket);
+	waitpid(worker.pid, nullptr, 0);
+	worker.socket = -1;
+	worker.pid = -1;
+
+	if (worker.restarts < maxRestarts) {
+		worker.restarts++;
+		cerr << "worker exited, restarting (" << worker.restarts << "/" << maxRestarts << ")" << endl;
+		if (spawn(worker)) {
+			assign(worker);
+		}
+	} else {
+		cerr << "worker exited too many times, dropping it" << endl;
+	}
+
+	// idle workers only ask for more once they finish a chunk, so the requeued frames are handed out here or
+	// they would never be picked up
+	for (Worker &other: workers) {
+		if (other.socket >= 0 && other.chunk.count == 0 && !pending.empty()) {
+			assign(other);
+		}
+	}
+}
+
+bool Coordinator::run() {
+	int total = job.lastFrame - job.firstFrame;
+	if (total <= 0) {
+		return true;
+	}
+
+	// workers write their frames as separate images, so the output has to name an image format
+	ImageFormat format;
+	if (!formatFromFileName(job.output, format)) {
+		cerr << "Can't write frames as " << job.output << ", use a .bmp, .ppm or .qoi file name" << endl;
+		return false;
+	}
+
+	pending = {{job.firstFrame, total}};
+	framesDone = 0;
+
+	for (Worker &worker: workers) {
+		if (spawn(worker)) {
+			assign(worker);
+		}
+	}
+
+	while (framesDone < total) {
+		vector<pollfd> fds;
+		vector<Worker *> polled;
+		for (Worker &worker: workers) {
+			if (worker.socket >= 0) {
+				fds.push_back({worker.socket, POLLIN, 0});
+				polled.push_back(&worker);
+			}
+		}
+		if (fds.empty()) {
+			cerr << "every worker failed, " << total - framesDone << " frames were not rendered" << endl;
+			return false;
+		}
+
+		if (poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+
+		for (size_t i = 0; i < fds.size(); i++) {
+			if (fds[i].revents == 0) {
+				continue;
+			}
+			Worker &worker = *polled[i];
+			DoneMessage done{};
+			if (!(fds[i].revents & POLLIN) || !readAll(worker.socket, &done, sizeof(done))) {
+				workerDied(worker);
+				continue;
+			}
+
+			// weight recent chunks more, frame times drift as the animation moves
+			framesDone += done.count;
+			float msPerFrame = done.milliseconds / (float) max(done.count, 1);
+			worker.msPerFrame = worker.msPerFrame > 0 ? 0.5f * worker.msPerFrame + 0.5f * msPerFrame : msPerFrame;
+			assign(worker);
+		}
+	}
+
+	// everything is rendered, tell the workers to exit
+	for (Worker &worker: workers) {
+		if (worker.socket >= 0) {
+			ChunkMessage stop = {0, 0};
+			writeAll(worker.socket, &stop, sizeof(stop));
+			close(worker.socket);
+			waitpid(worker.pid, nullptr, 0);
+			worker.socket = -1;
+		}
+	}
+	return true;
+}
+
+int nsGraphics::runWorker(int socket, const RenderJob &job) {
+	vector<Object> objects;
+	Scene scene(objects);
+	AssetManager assets;
+	if (!assets.loadScene(job.sceneFile, scene)) {
+		return 1;
+	}
+	assets.finish(scene);
+
+	Renderer renderer(scene, RenderTarget(job.width, job.height));
+
+	// two frames in flight, so one is rasterized, shaded and encoded while the next is posed and transformed
+	JobSystem jobs;
+	PipelinedFrame frames[2] = {PipelinedFrame(job.width, job.height), PipelinedFrame(job.width, job.height)};
+
+	// frames are posed from the scene file's transforms, so any worker can render any frame
+	SceneGraph &graph = renderer.scene.graph;
+	vector<Transform> rest;
+	for (int node = 0; node < graph.size(); node++) {
+		rest.push_back(graph.local(node));
+	}
+
+	ChunkMessage chunk{};
+	while (readAll(socket, &chunk, sizeof(chunk)) && chunk.count > 0) {
+		auto start = chrono::steady_clock::now();
+		for (int frame = chunk.first; frame < chunk.first + chunk.count; frame++) {
+			for (int node = 0; node < graph.size(); node++) {
+				graph.edit(node) = rest[node];
+			}
+			graph.animate((float) frame / job.fps);
+			string fileName = frameFileName(job.output, frame);
+			renderer.renderFrame(frames[frame % 2], jobs, [fileName](const RenderTarget &target) {
+				writeImage(FrameView(target), fileName);
+			});
+		}
+
+		// only report the chunk once it is on disk, so frames from a worker that dies are never lost
+		frames[0].wait();
+		frames[1].wait();
+		float milliseconds = chrono::duration<float, milli>(chrono::steady_clock::now() - start).count();
+		DoneMessage done = {chunk.first, chunk.count, milliseconds};
+		if (!writeAll(socket, &done, sizeof(done))) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+#else
+
+void Coordinator::assign(Worker &worker) {}
+
+void Coordinator::workerDied(Worker &worker) {}
+
+bool Coordinator::spawn(Worker &worker) {
+	return false;
+}
+
+// worker processes need fork and unix domain sockets
+bool Coordinator::run() {
+	cerr << "multi-process rendering is not supported on this platform" << endl;
+	return false;
+}
+
+int nsGraphics::runWorker(int socket, const RenderJob &job) {
+	return 1;
+}
+
+#endif
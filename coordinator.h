@@ -0,0 +1,80 @@
+//
+// Created by nates on 10/18/2026.
+//
+
+#ifndef RENDERINGPROJECT_COORDINATOR_H
+#define RENDERINGPROJECT_COORDINATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+
+namespace nsGraphics {
+
+	// an animation to render offline, frames firstFrame up to (not including) lastFrame
+	class RenderJob {
+	public:
+		std::string sceneFile;
+		std::string output;		// frame numbers go before the extension, frames/shot.bmp -> frames/shot0001.bmp
+		int width = 1280;
+		int height = 720;
+		float fps = 30;
+		int firstFrame = 0;
+		int lastFrame = 0;
+	};
+
+	std::string frameFileName(const std::string &output, int frame);
+
+	// messages sent over each worker's socket. A chunk with count 0 tells the worker to exit
+	struct ChunkMessage {
+		int32_t first;
+		int32_t count;
+	};
+
+	struct DoneMessage {
+		int32_t first;
+		int32_t count;
+		float milliseconds;		// time spent rendering and writing the chunk
+	};
+
+	// splits a job across headless worker processes, each started as "<executable> --worker ..." and connected by a
+	// unix domain socket. Chunks are sized from each worker's measured frame time, and the frames of a worker that
+	// dies are queued again and the worker restarted
+	class Coordinator {
+		struct Worker {
+			int pid = -1;
+			int socket = -1;
+			ChunkMessage chunk = {0, 0};	// in progress, count 0 when idle
+			float msPerFrame = 0;			// 0 until the first chunk comes back
+			int restarts = 0;
+		};
+
+		RenderJob job;
+		std::string executable;
+		std::vector<Worker> workers;
+		std::deque<ChunkMessage> pending;	// frame ranges not handed out yet
+		int framesDone = 0;
+
+		bool spawn(Worker &worker);
+
+		void assign(Worker &worker);
+
+		void workerDied(Worker &worker);
+
+	public:
+		float chunkSeconds = 2;		// target time per chunk once a worker's frame time is known
+		int maxRestarts = 3;		// per worker, a worker that keeps dying is dropped
+
+		Coordinator(std::string executable, RenderJob job, int numWorkers);
+
+		// returns false if frames were left unrendered because every worker failed
+		bool run();
+	};
+
+	// worker side of the protocol, renders the chunks it is sent until told to stop. Returns the exit code
+	int runWorker(int socket, const RenderJob &job);
+
+}
+
+#endif //RENDERINGPROJECT_COORDINATOR_H
@@ -0,0 +1,170 @@
+/*
+ * Author: Nate Shaffer
+ * Email: nshaffe4@u.rochester.edu
+ * Date Created: 10/18/2026
+ *
+ * Work stealing job system and dependency graphs of jobs, used to overlap the stages of consecutive frames
+ */
+
+#include <algorithm>
+#include "jobs.h"
+
+using namespace std;
+using namespace nsGraphics;
+
+// which pool the current thread works for, and its queue in that pool
+static thread_local JobSystem *currentSystem = nullptr;
+static thread_local int currentQueue = -1;
+
+JobSystem::JobSystem(int numThreads) : queued(0), nextQueue(0), stopping(false) {
+	int n = max(1, numThreads);
+	for (int i = 0; i < n; i++) {
+		queues.push_back(make_unique<Queue>());
+	}
+	for (int i = 0; i < n; i++) {
+		workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		lock_guard<mutex> guard(sleepLock);
+		stopping = true;
+	}
+	jobReady.notify_all();
+	for (thread &worker: workers) {
+		worker.join();
+	}
+}
+
+int JobSystem::size() const {
+	return (int) workers.size();
+}
+
+void JobSystem::submit(function<void()> job) {
+	int target = currentSystem == this ? currentQueue : (int) (nextQueue++ % queues.size());
+	{
+		lock_guard<mutex> guard(queues[target]->lock);
+		queues[target]->jobs.push_back(std::move(job));
+	}
+
+	// counted under the sleep lock so a worker can't miss it between checking and going to sleep
+	{
+		lock_guard<mutex> guard(sleepLock);
+		queued++;
+	}
+	jobReady.notify_one();
+}
+
+// runs the newest job on our own queue, or else the oldest job on someone else's. False if every queue was empty
+bool JobSystem::runOne(int self) {
+	function<void()> job;
+	int n = (int) queues.size();
+	for (int k = 0; k < n && !job; k++) {
+		Queue &q = *queues[(self + k) % n];
+		lock_guard<mutex> guard(q.lock);
+		if (q.jobs.empty()) {
+			continue;
+		}
+		if (k == 0) {
+			job = std::move(q.jobs.back());
+			q.jobs.pop_back();
+		} else {
+			job = std::move(q.jobs.front());
+			q.jobs.pop_front();
+		}
+	}
+	if (!job) {
+		return false;
+	}
+
+	queued--;
+	job();
+	return true;
+}
+
+void JobSystem::workerLoop(int self) {
+	currentSystem = this;
+	currentQueue = self;
+	while (true) {
+		if (runOne(self)) {
+			continue;
+		}
+
+		unique_lock<mutex> guard(sleepLock);
+		jobReady.wait(guard, [this] { return stopping || queued > 0; });
+		if (stopping && queued == 0) {
+			return;
+		}
+	}
+}
+
+TaskGraph::~TaskGraph() {
+	if (jobs) {
+		wait();
+	}
+}
+
+int TaskGraph::add(function<void()> job) {
+	tasks.emplace_back();
+	tasks.back().run = std::move(job);
+	return (int) tasks.size() - 1;
+}
+
+void TaskGraph::precede(int before, int after) {
+	tasks[before].successors.push_back(after);
+	tasks[after].dependencies++;
+}
+
+int TaskGraph::size() const {
+	return (int) tasks.size();
+}
+
+void TaskGraph::run(JobSystem &jobSystem) {
+	jobs = &jobSystem;
+	remaining = (int) tasks.size();
+	for (Task &task: tasks) {
+		task.waitingOn = task.dependencies;
+	}
+	for (int t = 0; t < (int) tasks.size(); t++) {
+		if (tasks[t].dependencies == 0) {
+			start(t);
+		}
+	}
+}
+
+void TaskGraph::start(int task) {
+	jobs->submit([this, task] {
+		tasks[task].run();
+		finish(task);
+	});
+}
+
+void TaskGraph::finish(int task) {
+	for (int successor: tasks[task].successors) {
+		if (--tasks[successor].waitingOn == 0) {
+			start(successor);
+		}
+	}
+
+	// notified under the lock, a waiter may destroy the graph as soon as it sees the last job finish
+	lock_guard<mutex> guard(lock);
+	tasks[task].finished = true;
+	remaining--;
+	progress.notify_all();
+}
+
+void TaskGraph::wait(int task) {
+	unique_lock<mutex> guard(lock);
+	progress.wait(guard, [this, task] { return tasks[task].finished; });
+}
+
+void TaskGraph::wait() {
+	unique_lock<mutex> guard(lock);
+	progress.wait(guard, [this] { return remaining == 0; });
+}
+
+bool TaskGraph::done() {
+	lock_guard<mutex> guard(lock);
+	return remaining == 0;
+}
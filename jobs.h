@@ -0,0 +1,107 @@
+//
+// Created by nates on 10/18/2026.
+//
+
+#ifndef RENDERINGPROJECT_JOBS_H
+#define RENDERINGPROJECT_JOBS_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+
+namespace nsGraphics {
+
+	// persistent worker threads that each keep their own queue of jobs. A worker runs its newest job first (its
+	// data is most likely still in cache) and, once its queue runs dry, steals the oldest job from another worker
+	class JobSystem {
+		struct Queue {
+			std::mutex lock;
+			std::deque<std::function<void()>> jobs;
+		};
+
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::vector<std::thread> workers;
+		std::mutex sleepLock;
+		std::condition_variable jobReady;
+		std::atomic<int> queued;				// jobs sitting in any queue
+		std::atomic<unsigned int> nextQueue;	// round robin for jobs submitted from outside the pool
+		bool stopping;
+
+		bool runOne(int self);
+
+		void workerLoop(int self);
+
+	public:
+		explicit JobSystem(int numThreads = (int) std::thread::hardware_concurrency());
+
+		JobSystem(const JobSystem &) = delete;
+		JobSystem &operator=(const JobSystem &) = delete;
+
+		// finishes every queued job before joining
+		~JobSystem();
+
+		[[nodiscard]] int size() const;
+
+		// jobs submitted from a worker go on that worker's own queue
+		void submit(std::function<void()> job);
+	};
+
+	// jobs with dependencies between them. Each job is submitted to the job system as soon as everything it
+	// depends on has finished, so independent work from different stages (or different graphs) runs side by side.
+	// Jobs and dependencies are added before run, and a graph is only run once
+	class TaskGraph {
+		struct Task {
+			std::function<void()> run;
+			std::vector<int> successors;
+			int dependencies = 0;
+			std::atomic<int> waitingOn = 0;
+			bool finished = false;			// guarded by lock
+		};
+
+		std::deque<Task> tasks;				// deque so tasks never move once added
+		JobSystem *jobs = nullptr;
+		int remaining = 0;					// guarded by lock
+		std::mutex lock;
+		std::condition_variable progress;
+
+		void start(int task);
+
+		void finish(int task);
+
+	public:
+		TaskGraph() = default;
+
+		TaskGraph(const TaskGraph &) = delete;
+		TaskGraph &operator=(const TaskGraph &) = delete;
+
+		// waits for the graph to finish, since running jobs still refer to it
+		~TaskGraph();
+
+		// returns the job's index, used to add dependencies and to wait on it
+		int add(std::function<void()> job);
+
+		// job after won't start until job before has finished
+		void precede(int before, int after);
+
+		[[nodiscard]] int size() const;
+
+		// submits every job with no dependencies, the rest follow as they become ready
+		void run(JobSystem &jobSystem);
+
+		// blocks until the given job has finished
+		void wait(int task);
+
+		// blocks until every job has finished
+		void wait();
+
+		[[nodiscard]] bool done();
+	};
+
+}
+
+#endif //RENDERINGPROJECT_JOBS_H
@@ -3,81 +3,233 @@
 #include <vector>
 #include <cstdlib>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <cmath>
 
 #include "raylib.h"
 #include "renderer.h"
 #include "scenes.h"
+#include "output.h"
+#include "assets.h"
+#include "coordinator.h"
+#include "triplebuffer.h"
 
 using namespace std;
 
-// writes the content in the frame buffer on the given render target to a BMP file
-void targetToBMP(nsGraphics::RenderTarget target, const string& name) {
-	int dataOffset = 14 + 40;
-	int rowSize = ((3 * target.width + 3) / 4) * 4;	// row size after padding
-	int dataSize = rowSize * target.height;
-	int fileSize = dataOffset + dataSize;
-
-	const char* fileName = name.c_str();
-	ofstream image(fileName, ios::binary);
-
-	// --BMP Header--
-	image.put('B'); image.put('M');									// file signature
-	image.write((char*)&fileSize, 4);									// file size
-	image.put(0); image.put(0); image.put(0); image.put(0);		// reserved
-	image.write((char*)&dataOffset, 4);								// frameBuffer offset
-
-	// --DIB Header--
-	int headerSize = 40;
-	image.write((char*)&headerSize, 4);								// DIB header size
-	image.write((char*)&target.width, 4);								// image width
-	image.write((char*)&target.height, 4);							// image height
-	short planes = 1;
-	image.write((char*)&planes, 2);									// num planes (?)
-	short bpp = 24;
-	image.write((char*)&bpp, 2);										// bits per pixel
-	int compression = 0;
-	image.write((char*)&compression, 4);								// rgb, no compression
-	image.write((char*)&dataSize, 4);									// frameBuffer size
-	char zeros[16] = {0};
-	image.write(zeros, 16);											// unused
-
-	// --Data--
-	for (int row = 0; row < target.height;  row++) {
-		vector<char> rowData(rowSize, 0);
-		for (int col = 0; col < target.width; col++) {
-			int xFirst = col * 3;
-			char b = (char) target.frameBuffer[4 * (target.width * row + col) + 2];
-			char g = (char) target.frameBuffer[4 * (target.width * row + col) + 1];
-			char r = (char) target.frameBuffer[4 * (target.width * row + col) + 0];
-			rowData[xFirst + 0] = b;
-			rowData[xFirst + 1] = g;
-			rowData[xFirst + 2] = r;
+// keys held down at the last poll of the window. Presses of T are counted rather than flagged so none are lost
+// when the simulation ticks slower than the window polls
+struct InputState {
+	bool left = false;
+	bool right = false;
+	bool forward = false;
+	bool back = false;
+	bool turnLeft = false;
+	bool turnRight = false;
+	bool lookUp = false;
+	bool lookDown = false;
+	int temporalToggles = 0;
+};
+
+// everything the render thread needs from the simulation to draw one frame
+struct SceneSnapshot {
+	nsGraphics::Camera camera;
+	vector<nsGraphics::Transform> transforms;		// per object in the scene
+	bool temporalReuse = false;
+};
+
+// moves the camera and animates the scene at a fixed rate, independent of how long frames take to render
+static void simulate(const atomic<bool> &running, nsGraphics::TripleBuffer<InputState> &input,
+					 nsGraphics::TripleBuffer<SceneSnapshot> &snapshots, nsGraphics::SceneGraph graph,
+					 SceneSnapshot state) {
+	const int tickRate = 120;
+	const float dt = 1.0f / tickRate;
+	const chrono::nanoseconds tick(1000000000 / tickRate);
+	float moveSpeed = 1;
+	int temporalToggles = 0;
+
+	auto nextTick = chrono::steady_clock::now();
+	while (running) {
+		input.update();
+		const InputState &keys = input.front();
+
+		float3 camRight = state.camera.rotation.i;
+		float3 camFwd = state.camera.rotation.k;
+
+		float3 moveDelta;
+
+		if (keys.left) moveDelta -= camRight;
+		if (keys.right) moveDelta += camRight;
+		if (keys.forward) moveDelta += camFwd;
+		if (keys.back) moveDelta -= camFwd;
+
+		state.camera.offset += moveDelta * dt;
+
+		if (keys.turnLeft) state.camera.rotation.addYaw(moveSpeed * dt);
+		if (keys.turnRight) state.camera.rotation.addYaw(-moveSpeed * dt);
+		if (keys.lookUp) state.camera.rotation.addPitch(moveSpeed * dt);
+		if (keys.lookDown) state.camera.rotation.addPitch(- moveSpeed * dt);
+
+		if ((keys.temporalToggles - temporalToggles) % 2 != 0) state.temporalReuse = !state.temporalReuse;
+		temporalToggles = keys.temporalToggles;
+
+		graph.animate(dt);
+		graph.update();
+		for (int node = 0; node < graph.size(); node++) {
+			int objectIndex = graph.object(node);
+			if (objectIndex >= 0 && objectIndex < (int) state.transforms.size()) {
+				state.transforms[objectIndex] = graph.world(node);
+			}
 		}
-		image.write(rowData.data(), rowSize);
+
+		// assigning into the slot reuses its storage
+		SceneSnapshot &snapshot = snapshots.back();
+		snapshot.camera = state.camera;
+		snapshot.transforms = state.transforms;
+		snapshot.temporalReuse = state.temporalReuse;
+		snapshots.publish();
+
+		// drop ticks rather than trying to catch up after a stall
+		nextTick += tick;
+		auto now = chrono::steady_clock::now();
+		if (nextTick < now) {
+			nextTick = now;
+		}
+		this_thread::sleep_until(nextTick);
 	}
+}
+
+// draws the latest snapshot as fast as the renderer allows, rendering straight into the frame slots the window
+// thread reads from
+static void renderFrames(const atomic<bool> &running, nsGraphics::TripleBuffer<SceneSnapshot> &snapshots,
+						 nsGraphics::TripleBuffer<nsGraphics::RenderTarget> &frames, nsGraphics::Renderer &renderer,
+						 nsGraphics::AssetManager &assets) {
+	while (running) {
+		// nothing has moved since the last frame
+		if (!snapshots.update()) {
+			this_thread::sleep_for(chrono::milliseconds(1));
+			continue;
+		}
+
+		// swap in any assets that finished loading, then pose the scene
+		assets.populate(renderer.scene);
+		const SceneSnapshot &snapshot = snapshots.front();
+		renderer.scene.camera = snapshot.camera;
+		for (size_t i = 0; i < snapshot.transforms.size() && i < renderer.scene.objects.size(); i++) {
+			nsGraphics::Object &o = renderer.scene.objects[i];
+			o.offset = snapshot.transforms[i].offset;
+			o.rotation = snapshot.transforms[i].rotation;
+			o.scale = snapshot.transforms[i].scale;
+		}
+		renderer.temporalReuse = snapshot.temporalReuse;
 
-	image.close();
+		// render targets only hold pointers, so this points the renderer at the free slot
+		renderer.target = frames.back();
+		renderer.render();
+		frames.publish();
+	}
 }
 
+// pans the camera slowly through the scene, drawing every frame both with temporal reuse and from scratch, and
+// fails if reuse ever drifts visibly from the full render. Objects are left where the scene file puts them
+static bool checkTemporal(const string &sceneFile, int numFrames) {
+	vector<nsGraphics::Object> objects;
+	nsGraphics::Scene scene(objects);
+	nsGraphics::AssetManager assets;
+	if (!assets.loadScene(sceneFile, scene)) {
+		return false;
+	}
+	assets.finish(scene);
 
-int main() {
+	const int width = 320;
+	const int height = 240;
+	const double minPsnr = 38;			// decibels, for any single frame
+	const double maxBadFraction = 0.01;	// of all pixels, off by more than badLevel in some channel
+	const int badLevel = 16;
 
-	// set up the scene
-	nsGraphics::Object model("models/monkey.obj");
-	model.offset = float3(0, 0, 5);
-	model.rotation = Rotation(M_PI * 0.9, 0);
-	model.texture = nsGraphics::Texture("textures/rainbow.bmp");
+	nsGraphics::Renderer full(scene, nsGraphics::RenderTarget(width, height));
+	nsGraphics::Renderer reused(scene, nsGraphics::RenderTarget(width, height));
+	reused.temporalReuse = true;
 
-//	nsGraphics::Object plane("models/plane.obj");
-//	plane.offset = float3(0, -1, 0);
-//	plane.texture = nsGraphics::Texture("textures/default.bmp");
+	bool passed = true;
+	for (int frame = 0; frame < numFrames; frame++) {
+		for (nsGraphics::Renderer *renderer: {&full, &reused}) {
+			renderer->scene.camera.offset += renderer->scene.camera.rotation.i * 0.01f;
+			renderer->scene.camera.rotation.addYaw(0.003f);
+			renderer->render();
+		}
 
-//	nsGraphics::Object bunny("models/bunny.obj");
-//	bunny.offset = float3(0, 2, 5);
-//	bunny.texture = nsGraphics::Texture("textures/default.bmp");
+		double squaredError = 0;
+		int badPixels = 0;
+		for (int p = 0; p < width * height; p++) {
+			int worst = 0;
+			for (int c = 0; c < 3; c++) {
+				int d = abs((int) full.target.frameBuffer[4 * p + c] - (int) reused.target.frameBuffer[4 * p + c]);
+				squaredError += d * d;
+				worst = max(worst, d);
+			}
+			badPixels += worst > badLevel;
+		}
+		double meanSquaredError = squaredError / (3.0 * width * height);
+		double psnr = meanSquaredError > 0 ? 10 * log10(255.0 * 255.0 / meanSquaredError) : INFINITY;
+		double badFraction = (double) badPixels / (width * height);
+		if (psnr < minPsnr || badFraction > maxBadFraction) {
+			cout << "frame " << frame << ": " << psnr << " dB, " << 100 * badFraction << "% of pixels off" << endl;
+			passed = false;
+		}
+	}
+	cout << (passed ? "temporal reuse matches full renders" : "temporal reuse differs from full renders") << endl;
+	return passed;
+}
+
+int main(int argc, char **argv) {
+
+	// offline texture compression: RenderingProject --compress <in.bmp> <out.dds> [bc1|bc3]
+	if (argc > 3 && string(argv[1]) == "--compress") {
+		bool bc3 = argc > 4 && string(argv[4]) == "bc3";
+		nsGraphics::Texture texture(argv[2]);
+		nsGraphics::TextureFormat format = bc3 ? nsGraphics::TextureFormat::BC3 : nsGraphics::TextureFormat::BC1;
+		return texture.compress(format).saveDDS(argv[3]) ? 0 : 1;
+	}
+
+	// offline animation across worker processes: RenderingProject --render <scene> <output> <first> <last> [workers]
+	// renders frames first up to but not including last
+	if (argc > 5 && string(argv[1]) == "--render") {
+		nsGraphics::RenderJob job;
+		job.sceneFile = argv[2];
+		job.output = argv[3];
+		job.firstFrame = atoi(argv[4]);
+		job.lastFrame = atoi(argv[5]);
+		int numWorkers = argc > 6 ? atoi(argv[6]) : 4;
+		nsGraphics::Coordinator coordinator(argv[0], job, numWorkers);
+		return coordinator.run() ? 0 : 1;
+	}
+
+	// compares temporal reuse against full renders: RenderingProject --check-temporal <scene> [frames]
+	if (argc > 2 && string(argv[1]) == "--check-temporal") {
+		return checkTemporal(argv[2], argc > 3 ? atoi(argv[3]) : 60) ? 0 : 1;
+	}
+
+	// started by the coordinator: --worker <socket> <scene> <output> <width> <height> <fps>
+	if (argc > 7 && string(argv[1]) == "--worker") {
+		nsGraphics::RenderJob job;
+		job.sceneFile = argv[3];
+		job.output = argv[4];
+		job.width = atoi(argv[5]);
+		job.height = atoi(argv[6]);
+		job.fps = (float) atof(argv[7]);
+		return nsGraphics::runWorker(atoi(argv[2]), job);
+	}
 
-	vector<nsGraphics::Object> objects = {model};
+	// read the scene file, models are filled in by the asset manager as they finish loading and are drawn as
+	// placeholders until they are ready
+	string sceneFile = argc > 1 ? argv[1] : "scenes/demo.scene";
+	vector<nsGraphics::Object> objects;
 	nsGraphics::Scene scene(objects);
+	nsGraphics::AssetManager assets;
+	if (!assets.loadScene(sceneFile, scene)) {
+		return 1;
+	}
 
 	// set up the renderer
 	int renderWidth = 1280;
@@ -95,34 +247,46 @@ int main() {
 	SetWindowState(FLAG_WINDOW_RESIZABLE);
 	RenderTexture2D renderTexture = LoadRenderTexture(renderWidth, renderHeight);
 
-	float moveSpeed = 1;
-	while (!WindowShouldClose()) {
-
-		// update scene
-		renderer.scene.objects[0].rotation.addYaw(GetFrameTime());
+	// the window thread polls input and presents frames, the simulation thread updates the scene at a fixed tick,
+	// and the render thread draws whatever the simulation last published. A slow frame only delays the picture
+	nsGraphics::TripleBuffer<InputState> input;
+	nsGraphics::TripleBuffer<SceneSnapshot> snapshots;
+	nsGraphics::TripleBuffer<nsGraphics::RenderTarget> frames(renderWidth, renderHeight);
 
+	SceneSnapshot initial;
+	initial.camera = renderer.scene.camera;
+	for (const nsGraphics::Object &o: renderer.scene.objects) {
+		initial.transforms.emplace_back(o.offset, o.rotation, o.scale);
+	}
+	initial.temporalReuse = renderer.temporalReuse;
 
-		// handle keyboard input
-		float3 camRight = renderer.scene.camera.rotation.i;
-		float3 camFwd = renderer.scene.camera.rotation.k;
+	atomic<bool> running = true;
+	thread simulation(simulate, cref(running), ref(input), ref(snapshots), renderer.scene.graph, initial);
+	thread rendering(renderFrames, cref(running), ref(snapshots), ref(frames), ref(renderer), ref(assets));
 
-		float3 moveDelta;
+	InputState keys;
+	while (!WindowShouldClose()) {
 
-		if (IsKeyDown(KEY_A)) moveDelta -= camRight;
-		if (IsKeyDown(KEY_D)) moveDelta += camRight;
-		if (IsKeyDown(KEY_W)) moveDelta += camFwd;
-		if (IsKeyDown(KEY_S)) moveDelta -= camFwd;
+		// handle keyboard input
+		keys.left = IsKeyDown(KEY_A);
+		keys.right = IsKeyDown(KEY_D);
+		keys.forward = IsKeyDown(KEY_W);
+		keys.back = IsKeyDown(KEY_S);
+		keys.turnLeft = IsKeyDown(KEY_LEFT);
+		keys.turnRight = IsKeyDown(KEY_RIGHT);
+		keys.lookUp = IsKeyDown(KEY_UP);
+		keys.lookDown = IsKeyDown(KEY_DOWN);
 
-		renderer.scene.camera.offset += moveDelta * GetFrameTime();
+		// T toggles reusing shading from the previous frame
+		if (IsKeyPressed(KEY_T)) keys.temporalToggles++;
 
-		if (IsKeyDown(KEY_LEFT)) renderer.scene.camera.rotation.addYaw(moveSpeed * GetFrameTime());
-		if (IsKeyDown(KEY_RIGHT)) renderer.scene.camera.rotation.addYaw(-moveSpeed * GetFrameTime());
-		if (IsKeyDown(KEY_UP)) renderer.scene.camera.rotation.addPitch(moveSpeed * GetFrameTime());
-		if (IsKeyDown(KEY_DOWN)) renderer.scene.camera.rotation.addPitch(- moveSpeed * GetFrameTime());
+		input.back() = keys;
+		input.publish();
 
-		// render and then write to the screen texture
-		renderer.render();
-		UpdateTexture(screenTexture, renderer.target.frameBuffer);
+		// upload the newest finished frame, if there is one
+		if (frames.update()) {
+			UpdateTexture(screenTexture, frames.front().frameBuffer);
+		}
 
 		// first writing to the RenderTexture2D
 		BeginTextureMode(renderTexture);
@@ -142,4 +306,7 @@ int main() {
 		EndDrawing();
 	}
 
+	running = false;
+	simulation.join();
+	rendering.join();
 }
@@ -109,6 +109,37 @@ float3 Rotation::applyInv(float3 v) const {
 	return {iInv.x*v.x + jInv.x*v.y + kInv.x*v.z, iInv.y*v.x + jInv.y*v.y + kInv.y*v.z, iInv.z*v.x + jInv.z*v.y + kInv.z*v.z};
 }
 
+// the axes addYaw and addPitch build from a yaw and pitch
+static void anglesToAxes(float yaw, float pitch, float3 &i, float3 &j, float3 &k) {
+	i = float3(cosf(yaw), 0, -sinf(yaw));
+	j = float3(sinf(yaw)*sinf(pitch), cosf(pitch), cosf(yaw)*sinf(pitch));
+	k = float3(sinf(yaw)*cosf(pitch), -sinf(pitch), cosf(yaw)*cosf(pitch));
+}
+
+Rotation Rotation::operator*(const Rotation &r) const {
+	Rotation result;
+	result.i = apply(r.i);
+	result.j = apply(r.j);
+	result.k = apply(r.k);
+
+	result.iInv = float3(result.i.x, result.j.x, result.k.x);
+	result.jInv = float3(result.i.y, result.j.y, result.k.y);
+	result.kInv = float3(result.i.z, result.j.z, result.k.z);
+
+	// read the angles back off the forward axis. If they don't rebuild the same axes (the result rolls), later
+	// turns have to work on the axes themselves
+	result.yaw = atan2f(result.k.x, result.k.z);
+	result.pitch = asinf(fmaxf(-1.0f, fminf(1.0f, -result.k.y)));
+	float3 i, j, k;
+	anglesToAxes(result.yaw, result.pitch, i, j, k);
+	const float tolerance = 1e-4f;
+	result.composed = fabsf(i.x - result.i.x) > tolerance ||
+					  fabsf(i.y - result.i.y) > tolerance || fabsf(i.z - result.i.z) > tolerance ||
+					  fabsf(j.x - result.j.x) > tolerance || fabsf(j.y - result.j.y) > tolerance ||
+					  fabsf(j.z - result.j.z) > tolerance;
+	return result;
+}
+
 Rotation::Rotation() : yaw(0), pitch(0) {
 	i = float3(1, 0, 0);
 	iInv = float3(1, 0, 0);
@@ -118,22 +149,36 @@ Rotation::Rotation() : yaw(0), pitch(0) {
 	kInv = float3(0, 0, 1);
 }
 
+// turns about the world's vertical axis
 void Rotation::addYaw(float delta) {
 	yaw -= delta;	// TODO fix this hack
-	i = float3(cosf(yaw), 0, -sinf(yaw));
-	j = float3(sinf(yaw)*sinf(pitch), cosf(pitch), cosf(yaw)*sinf(pitch));
-	k = float3(sinf(yaw)*cosf(pitch), -sinf(pitch), cosf(yaw)*cosf(pitch));
+	if (composed) {
+		float c = cosf(delta);
+		float s = sinf(delta);
+		i = float3(c*i.x - s*i.z, i.y, s*i.x + c*i.z);
+		j = float3(c*j.x - s*j.z, j.y, s*j.x + c*j.z);
+		k = float3(c*k.x - s*k.z, k.y, s*k.x + c*k.z);
+	} else {
+		anglesToAxes(yaw, pitch, i, j, k);
+	}
 
 	iInv = float3(i.x, j.x, k.x);
 	jInv = float3(i.y, j.y, k.y);
 	kInv = float3(i.z, j.z, k.z);
 }
 
+// tilts about the rotation's own horizontal axis
 void Rotation::addPitch(float delta) {
 	pitch -= delta;	// TODO fix this hack
-	i = float3(cosf(yaw), 0, -sinf(yaw));
-	j = float3(sinf(yaw)*sinf(pitch), cosf(pitch), cosf(yaw)*sinf(pitch));
-	k = float3(sinf(yaw)*cosf(pitch), -sinf(pitch), cosf(yaw)*cosf(pitch));
+	if (composed) {
+		float c = cosf(delta);
+		float s = sinf(delta);
+		float3 up = j;
+		j = j*c - k*s;
+		k = k*c + up*s;
+	} else {
+		anglesToAxes(yaw, pitch, i, j, k);
+	}
 
 	iInv = float3(i.x, j.x, k.x);
 	jInv = float3(i.y, j.y, k.y);
@@ -93,6 +93,19 @@ inline float dot(float3 v1, float3 v2) {
 	return v1.x*v2.x + v1.y*v2.y + v1.z*v2.z;
 }
 
+inline float3 cross(float3 v1, float3 v2) {
+	return {v1.y*v2.z - v1.z*v2.y, v1.z*v2.x - v1.x*v2.z, v1.x*v2.y - v1.y*v2.x};
+}
+
+// component-wise product, used for tinting colors
+inline float3 mul(float3 v1, float3 v2) {
+	return {v1.x*v2.x, v1.y*v2.y, v1.z*v2.z};
+}
+
+inline float length(float3 v) {
+	return std::sqrt(dot(v, v));
+}
+
 float dot(float2 v1, float2 v2);
 
 inline float edgeFunc(float2 a, float2 b, float2 p) {
@@ -113,6 +126,8 @@ public:
 
 	float yaw;
 	float pitch;
+	bool composed = false;	// the product of rotations that yaw and pitch can't describe, such as a child under a
+							// pitched parent. Turning it rotates the axes directly instead of rebuilding them
 
 	Rotation(float yaw, float pitch);
 	Rotation();
@@ -120,6 +135,9 @@ public:
 	float3 apply(float3 v) const;
 	float3 applyInv(float3 v) const;
 
+	// rotation that applies r first and then this one, with yaw and pitch taken from where it faces
+	Rotation operator*(const Rotation &r) const;
+
 	void addYaw(float delta);
 	void addPitch(float delta);
 };
@@ -0,0 +1,373 @@
+/*
+ * Author: Nate Shaffer
+ * Email: nshaffe4@u.rochester.edu
+ * Date Created: 10/18/2026
+ *
+ * Frame output: image encoders (BMP, PPM, QOI), a Y4M video stream, and background writers so that encoding
+ * and disk access never stall the renderer
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "output.h"
+
+using namespace std;
+using namespace nsGraphics;
+
+FrameView::FrameView(int width, int height, const byte *pixels) : width(width), height(height), pixels(pixels) {}
+
+FrameView::FrameView(const RenderTarget &target) : width(target.width), height(target.height),
+												   pixels(target.frameBuffer) {}
+
+// appends a little endian integer of the given size
+static void putLE(vector<char> &out, uint32_t value, int bytes) {
+	for (int i = 0; i < bytes; i++) {
+		out.push_back((char) ((value >> (8 * i)) & 0xFF));
+	}
+}
+
+static void putBE(vector<char> &out, uint32_t value, int bytes) {
+	for (int i = bytes - 1; i >= 0; i--) {
+		out.push_back((char) ((value >> (8 * i)) & 0xFF));
+	}
+}
+
+void nsGraphics::encodeBMP(const FrameView &frame, vector<char> &out) {
+	int dataOffset = 14 + 40;
+	int rowSize = ((3 * frame.width + 3) / 4) * 4;	// row size after padding
+	int dataSize = rowSize * frame.height;
+	int fileSize = dataOffset + dataSize;
+
+	size_t start = out.size();
+	out.reserve(start + fileSize);
+
+	// --BMP Header--
+	out.push_back('B'); out.push_back('M');							// file signature
+	putLE(out, fileSize, 4);											// file size
+	putLE(out, 0, 4);													// reserved
+	putLE(out, dataOffset, 4);											// frameBuffer offset
+
+	// --DIB Header--
+	putLE(out, 40, 4);													// DIB header size
+	putLE(out, frame.width, 4);										// image width
+	putLE(out, frame.height, 4);										// image height
+	putLE(out, 1, 2);													// num planes
+	putLE(out, 24, 2);													// bits per pixel
+	putLE(out, 0, 4);													// rgb, no compression
+	putLE(out, dataSize, 4);											// frameBuffer size
+	putLE(out, 0, 16);													// unused
+
+	// --Data--
+	out.resize(start + fileSize, 0);
+	char *data = out.data() + start + dataOffset;
+	for (int row = 0; row < frame.height; row++) {
+		char *rowData = data + row * rowSize;
+		const byte *src = frame.pixel(row, 0);
+		for (int col = 0; col < frame.width; col++) {
+			rowData[3 * col + 0] = (char) src[4 * col + 2];
+			rowData[3 * col + 1] = (char) src[4 * col + 1];
+			rowData[3 * col + 2] = (char) src[4 * col + 0];
+		}
+	}
+}
+
+// binary PPM. Like the remaining formats it is stored top down, so rows are written last to first to match BMP
+void nsGraphics::encodePPM(const FrameView &frame, vector<char> &out) {
+	string header = "P6\n" + to_string(frame.width) + " " + to_string(frame.height) + "\n255\n";
+	size_t start = out.size();
+	out.resize(start + header.size() + 3 * (size_t) frame.width * frame.height);
+	memcpy(out.data() + start, header.data(), header.size());
+
+	char *data = out.data() + start + header.size();
+	for (int row = frame.height - 1; row >= 0; row--) {
+		const byte *src = frame.pixel(row, 0);
+		for (int col = 0; col < frame.width; col++) {
+			*data++ = (char) src[4 * col + 0];
+			*data++ = (char) src[4 * col + 1];
+			*data++ = (char) src[4 * col + 2];
+		}
+	}
+}
+
+// "Quite OK Image" format, lossless and several times smaller than BMP while still cheap to encode
+void nsGraphics::encodeQOI(const FrameView &frame, vector<char> &out) {
+	struct Pixel { uint8_t r, g, b, a; };
+
+	out.insert(out.end(), {'q', 'o', 'i', 'f'});
+	putBE(out, frame.width, 4);
+	putBE(out, frame.height, 4);
+	out.push_back(3);				// channels, the frame buffer alpha is always opaque
+	out.push_back(0);				// sRGB with linear alpha
+
+	Pixel seen[64] = {};
+	Pixel prev = {0, 0, 0, 255};
+	int run = 0;
+
+	for (int row = frame.height - 1; row >= 0; row--) {
+		const byte *src = frame.pixel(row, 0);
+		for (int col = 0; col < frame.width; col++) {
+			Pixel p = {(uint8_t) src[4 * col + 0], (uint8_t) src[4 * col + 1], (uint8_t) src[4 * col + 2], 255};
+
+			if (p.r == prev.r && p.g == prev.g && p.b == prev.b) {
+				run++;
+				if (run == 62) {
+					out.push_back((char) (0xC0 | (run - 1)));
+					run = 0;
+				}
+				continue;
+			}
+			if (run > 0) {
+				out.push_back((char) (0xC0 | (run - 1)));
+				run = 0;
+			}
+
+			int hash = (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64;
+			if (seen[hash].r == p.r && seen[hash].g == p.g && seen[hash].b == p.b && seen[hash].a == p.a) {
+				out.push_back((char) hash);
+			} else {
+				seen[hash] = p;
+
+				auto dr = (int8_t) (p.r - prev.r);
+				auto dg = (int8_t) (p.g - prev.g);
+				auto db = (int8_t) (p.b - prev.b);
+				int drg = dr - dg;
+				int dbg = db - dg;
+
+				if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+					out.push_back((char) (0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+				} else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+					out.push_back((char) (0x80 | (dg + 32)));
+					out.push_back((char) ((drg + 8) << 4 | (dbg + 8)));
+				} else {
+					out.push_back((char) 0xFE);
+					out.push_back((char) p.r);
+					out.push_back((char) p.g);
+					out.push_back((char) p.b);
+				}
+			}
+			prev = p;
+		}
+	}
+	if (run > 0) {
+		out.push_back((char) (0xC0 | (run - 1)));
+	}
+
+	// end marker
+	out.insert(out.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+}
+
+bool nsGraphics::formatFromFileName(const string &fileName, ImageFormat &format) {
+	size_t dot = fileName.find_last_of('.');
+	if (dot == string::npos) {
+		return false;
+	}
+	string extension = fileName.substr(dot + 1);
+	transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	if (extension == "bmp") {
+		format = ImageFormat::BMP;
+	} else if (extension == "ppm") {
+		format = ImageFormat::PPM;
+	} else if (extension == "qoi") {
+		format = ImageFormat::QOI;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+void nsGraphics::writeImage(const FrameView &frame, const string &fileName, ImageFormat format) {
+	// encode into a per thread buffer so repeated frames don't reallocate
+	thread_local vector<char> data;
+	data.clear();
+	switch (format) {
+		case ImageFormat::BMP:
+			encodeBMP(frame, data);
+			break;
+		case ImageFormat::PPM:
+			encodePPM(frame, data);
+			break;
+		case ImageFormat::QOI:
+			encodeQOI(frame, data);
+			break;
+	}
+
+	ofstream image(fileName, ios::binary);
+	if (!image) {
+		cerr << "Could not open " << fileName << " for writing" << endl;
+		return;
+	}
+	image.write(data.data(), (streamsize) data.size());
+}
+
+void nsGraphics::writeImage(const FrameView &frame, const string &fileName) {
+	ImageFormat format;
+	if (!formatFromFileName(fileName, format)) {
+		cerr << "Unsupported image format " << fileName << endl;
+		return;
+	}
+	writeImage(frame, fileName, format);
+}
+
+void nsGraphics::targetToBMP(const RenderTarget &target, const string &name) {
+	writeImage(FrameView(target), name, ImageFormat::BMP);
+}
+
+FrameWriter::FrameWriter(int numThreads, size_t maxQueued) : maxQueued(max((size_t) 1, maxQueued)), busy(0),
+															 stopping(false) {
+	for (int i = 0; i < max(1, numThreads); i++) {
+		workers.emplace_back(&FrameWriter::workerLoop, this);
+	}
+}
+
+FrameWriter::~FrameWriter() {
+	flush();
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	jobReady.notify_all();
+	for (thread &worker: workers) {
+		worker.join();
+	}
+}
+
+void FrameWriter::workerLoop() {
+	unique_lock<mutex> guard(lock);
+	while (true) {
+		jobReady.wait(guard, [this] { return stopping || !queue.empty(); });
+		if (queue.empty()) {
+			return;
+		}
+
+		Job job = std::move(queue.front());
+		queue.pop_front();
+		busy++;
+		slotFree.notify_one();
+
+		guard.unlock();
+		job.encode(FrameView(job.width, job.height, job.pixels.data()));
+		guard.lock();
+
+		freeBuffers.push_back(std::move(job.pixels));
+		busy--;
+		if (queue.empty() && busy == 0) {
+			idle.notify_all();
+		}
+	}
+}
+
+void FrameWriter::submit(const FrameView &frame, function<void(const FrameView &)> encode) {
+	size_t size = 4 * (size_t) frame.width * frame.height;
+
+	unique_lock<mutex> guard(lock);
+	slotFree.wait(guard, [this] { return queue.size() < maxQueued; });
+
+	vector<byte> pixels;
+	if (!freeBuffers.empty()) {
+		pixels = std::move(freeBuffers.back());
+		freeBuffers.pop_back();
+	}
+
+	// copying is a single memcpy, much cheaper than holding the render target until the encoder is done
+	guard.unlock();
+	pixels.resize(size);
+	memcpy(pixels.data(), frame.pixels, size);
+	guard.lock();
+
+	slotFree.wait(guard, [this] { return queue.size() < maxQueued; });
+	queue.push_back({frame.width, frame.height, std::move(pixels), std::move(encode)});
+	jobReady.notify_one();
+}
+
+void FrameWriter::write(const FrameView &frame, const string &fileName, ImageFormat format) {
+	submit(frame, [fileName, format](const FrameView &f) { writeImage(f, fileName, format); });
+}
+
+void FrameWriter::write(const FrameView &frame, const string &fileName) {
+	ImageFormat format;
+	if (!formatFromFileName(fileName, format)) {
+		cerr << "Unsupported image format " << fileName << endl;
+		return;
+	}
+	write(frame, fileName, format);
+}
+
+void FrameWriter::flush() {
+	unique_lock<mutex> guard(lock);
+	idle.wait(guard, [this] { return queue.empty() && busy == 0; });
+}
+
+// a single encoding thread keeps the frames in order
+Y4MWriter::Y4MWriter(const string &fileName, int width, int height, int fps, size_t maxQueued) :
+		file(fileName, ios::binary), width(width), height(height), writer(1, maxQueued) {
+	if (!file) {
+		cerr << "Could not open " << fileName << " for writing" << endl;
+	}
+	file << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+}
+
+Y4MWriter::~Y4MWriter() {
+	writer.flush();
+}
+
+// converts to full range BT.601 YCbCr, averaging chroma over each 2x2 block
+void Y4MWriter::encodeFrame(const FrameView &frame) {
+	int chromaWidth = (width + 1) / 2;
+	int chromaHeight = (height + 1) / 2;
+	size_t lumaSize = (size_t) width * height;
+	size_t chromaSize = (size_t) chromaWidth * chromaHeight;
+
+	frameData.resize(6 + lumaSize + 2 * chromaSize);
+	memcpy(frameData.data(), "FRAME\n", 6);
+	auto *luma = (uint8_t *) frameData.data() + 6;
+	uint8_t *cb = luma + lumaSize;
+	uint8_t *cr = cb + chromaSize;
+
+	auto toByte = [](float v) { return (uint8_t) min(255.0f, max(0.0f, v + 0.5f)); };
+
+	for (int y = 0; y < height; y++) {
+		const byte *src = frame.pixel(height - 1 - y, 0);
+		for (int x = 0; x < width; x++) {
+			auto r = (float) src[4 * x + 0];
+			auto g = (float) src[4 * x + 1];
+			auto b = (float) src[4 * x + 2];
+			luma[y * width + x] = toByte(0.299f * r + 0.587f * g + 0.114f * b);
+		}
+	}
+
+	for (int cy = 0; cy < chromaHeight; cy++) {
+		for (int cx = 0; cx < chromaWidth; cx++) {
+			float r = 0, g = 0, b = 0;
+			int count = 0;
+			for (int y = 2 * cy; y < min(height, 2 * cy + 2); y++) {
+				const byte *src = frame.pixel(height - 1 - y, 0);
+				for (int x = 2 * cx; x < min(width, 2 * cx + 2); x++) {
+					r += (float) src[4 * x + 0];
+					g += (float) src[4 * x + 1];
+					b += (float) src[4 * x + 2];
+					count++;
+				}
+			}
+			r /= (float) count;
+			g /= (float) count;
+			b /= (float) count;
+			cb[cy * chromaWidth + cx] = toByte(128 - 0.168736f * r - 0.331264f * g + 0.5f * b);
+			cr[cy * chromaWidth + cx] = toByte(128 + 0.5f * r - 0.418688f * g - 0.081312f * b);
+		}
+	}
+
+	file.write(frameData.data(), (streamsize) frameData.size());
+}
+
+void Y4MWriter::write(const FrameView &frame) {
+	if (frame.width != width || frame.height != height) {
+		cerr << "Y4M frame is " << frame.width << "x" << frame.height << ", expected " << width << "x" << height << endl;
+		return;
+	}
+	writer.submit(frame, [this](const FrameView &f) { encodeFrame(f); });
+}
+
+void Y4MWriter::flush() {
+	writer.flush();
+	file.flush();
+}
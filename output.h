@@ -0,0 +1,125 @@
+//
+// Created by nates on 10/18/2026.
+//
+
+#ifndef RENDERINGPROJECT_OUTPUT_H
+#define RENDERINGPROJECT_OUTPUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "renderer.h"
+
+namespace nsGraphics {
+
+	enum class ImageFormat {
+		BMP,
+		PPM,
+		QOI
+	};
+
+	// a borrowed, read-only view of an RGBA8 frame buffer, row 0 is the bottom row, as in BMP
+	class FrameView {
+	public:
+		int width;
+		int height;
+		const std::byte *pixels;
+
+		FrameView(int width, int height, const std::byte *pixels);
+
+		explicit FrameView(const RenderTarget &target);
+
+		[[nodiscard]] inline const std::byte *pixel(int row, int col) const {
+			return pixels + 4 * (width * row + col);
+		}
+	};
+
+	// encoders append a complete file to out, so each frame ends up as a single write call
+	void encodeBMP(const FrameView &frame, std::vector<char> &out);
+	void encodePPM(const FrameView &frame, std::vector<char> &out);
+	void encodeQOI(const FrameView &frame, std::vector<char> &out);
+
+	// picks the format from the extension, false if it isn't an image format (.y4m is written with Y4MWriter)
+	bool formatFromFileName(const std::string &fileName, ImageFormat &format);
+
+	void writeImage(const FrameView &frame, const std::string &fileName, ImageFormat format);
+
+	void writeImage(const FrameView &frame, const std::string &fileName);
+
+	// writes the content in the frame buffer on the given render target to a BMP file
+	void targetToBMP(const RenderTarget &target, const std::string &name);
+
+	// encodes frames on background threads. Submitting copies the view into a recycled buffer, so the caller
+	// can keep rendering into its target straight away; it only blocks once maxQueued frames are waiting
+	class FrameWriter {
+		struct Job {
+			int width;
+			int height;
+			std::vector<std::byte> pixels;
+			std::function<void(const FrameView &)> encode;
+		};
+
+		std::vector<std::thread> workers;
+		std::deque<Job> queue;
+		std::vector<std::vector<std::byte>> freeBuffers;
+		std::mutex lock;
+		std::condition_variable jobReady;
+		std::condition_variable slotFree;
+		std::condition_variable idle;
+		size_t maxQueued;
+		int busy;
+		bool stopping;
+
+		void workerLoop();
+
+	public:
+		FrameWriter(int numThreads = 2, size_t maxQueued = 8);
+
+		FrameWriter(const FrameWriter &) = delete;
+		FrameWriter &operator=(const FrameWriter &) = delete;
+
+		~FrameWriter();
+
+		// queue an arbitrary encode step, jobs start in submission order
+		void submit(const FrameView &frame, std::function<void(const FrameView &)> encode);
+
+		void write(const FrameView &frame, const std::string &fileName, ImageFormat format);
+
+		void write(const FrameView &frame, const std::string &fileName);
+
+		// blocks until every queued frame has been written
+		void flush();
+	};
+
+	// streams frames into a single raw YUV4MPEG2 (4:2:0) video file. Frames are converted and written on a
+	// background thread in the order they are submitted
+	class Y4MWriter {
+		std::ofstream file;
+		int width;
+		int height;
+		std::vector<char> frameData;
+		FrameWriter writer;
+
+		void encodeFrame(const FrameView &frame);
+
+	public:
+		Y4MWriter(const std::string &fileName, int width, int height, int fps, size_t maxQueued = 8);
+
+		void write(const FrameView &frame);
+
+		void flush();
+
+		~Y4MWriter();
+	};
+
+}
+
+#endif //RENDERINGPROJECT_OUTPUT_H
@@ -7,6 +7,7 @@
  */
 
 #include <sstream>
+#include <algorithm>
 #include <utility>
 #include "renderer.h"
 
@@ -19,27 +20,47 @@ RenderTarget::RenderTarget(int w, int h) : width(w), height(h) {
 }
 
 // clears a render target to all black with full alpha
+// (clears in place, so views of the frame buffer stay valid and long sequences don't leak a frame per render)
 void RenderTarget::clear() {
-	frameBuffer = new byte [4 * width * height];
-	for (int row = 0; row < height; row++) {
-		for (int col = 0; col < width; col++) {
-			frameBuffer[4*(row*width + col) + 3] = (byte) 255;
-		}
+	for (int i = 0; i < width * height; i++) {
+		frameBuffer[4 * i + 0] = (byte) 0;
+		frameBuffer[4 * i + 1] = (byte) 0;
+		frameBuffer[4 * i + 2] = (byte) 0;
+		frameBuffer[4 * i + 3] = (byte) 255;
 	}
-	zBuffer = new float [width * height];
+	fill(zBuffer, zBuffer + width * height, 0.0f);
 }
 
-Renderer::Renderer(const Scene& scene, RenderTarget target) : scene(scene), target(target) {
-	float screenWidthWorld = 2 * tanf(scene.camera.fov / 2);
+View::View(const Camera &camera, RenderTarget target) : camera(camera), target(target) {
+	float screenWidthWorld = 2 * tanf(camera.fov / 2);
 	pixelsPerWorldUnit = (float) target.width / screenWidthWorld;
 }
 
-// converts from world space to screen space, storing inverse z coordinate in the third entry
-float3 Renderer::worldToScreen(const float3 &p) const {
-	float3 pView = scene.camera.rotation.applyInv(p - scene.camera.offset);
+float3 View::worldToScreen(const float3 &p) const {
+	float3 pView = camera.rotation.applyInv(p - camera.offset);
 	return {pView.x * pixelsPerWorldUnit / pView.z + (float) target.width / 2, pView.y * pixelsPerWorldUnit / pView.z + (float) target.height / 2, 1 / pView.z};
 }
 
+// tests against the side planes of the view frustum in view space
+bool View::sphereVisible(const float3 &center, float radius) const {
+	float3 c = camera.rotation.applyInv(center - camera.offset);
+	if (c.z < -radius) {
+		return false;
+	}
+	float tanX = (float) target.width / (2 * pixelsPerWorldUnit);
+	float tanY = (float) target.height / (2 * pixelsPerWorldUnit);
+	float normX = sqrtf(1 + tanX * tanX);
+	float normY = sqrtf(1 + tanY * tanY);
+	return !(c.x - tanX * c.z > radius * normX || -c.x - tanX * c.z > radius * normX ||
+			 c.y - tanY * c.z > radius * normY || -c.y - tanY * c.z > radius * normY);
+}
+
+Renderer::Renderer(const Scene& scene, RenderTarget target) : scene(scene), target(target) {}
+
+float3 Renderer::worldToScreen(const float3 &p) const {
+	return View(scene.camera, target).worldToScreen(p);
+}
+
 // computes the bounding box of p1, p2, and p3, within the width and height of target
 auto getBoundingBox(const float2& p1, const float2& p2, const float2& p3, const RenderTarget& target) {
 	struct BoundingBox {int xMin; int xMax; int yMin; int yMax;};
@@ -57,81 +78,269 @@ auto getBoundingBox(const float2& p1, const float2& p2, const float2& p3, const
 	return box;
 }
 
-void Renderer::drawObject(const Object& o) {
-	for (int i = 0; i < o.numTriangles; i++) {
+// bins point and spot lights into screen tiles by the screen space bounds of their range, directional lights reach
+// every pixel and are kept in their own list
+void Renderer::buildLightTiles(View &view) const {
+	const RenderTarget &target = view.target;
+	int tilesX = (target.width + tileSize - 1) / tileSize;
+	int tilesY = (target.height + tileSize - 1) / tileSize;
+	vector<vector<int>> bins(tilesX * tilesY);
+
+	for (int l = 0; l < (int) view.lights.size(); l++) {
+		const Light &light = view.lights[l];
+		if (light.type == LightType::Directional) {
+			continue;
+		}
+
+		float3 c = view.camera.rotation.applyInv(light.position - view.camera.offset);
+		float r = light.range;
+		if (c.z + r <= 0) {
+			continue;
+		}
+
+		// x/z and y/z over the box around the sphere are extreme at its corners, unless it reaches behind the camera
+		int xMin = 0, xMax = tilesX - 1, yMin = 0, yMax = tilesY - 1;
+		if (c.z - r > 0) {
+			float nearZ = c.z - r;
+			float farZ = c.z + r;
+			float ppw = view.pixelsPerWorldUnit;
+			float left = min((c.x - r) / nearZ, (c.x - r) / farZ) * ppw + (float) target.width / 2;
+			float right = max((c.x + r) / nearZ, (c.x + r) / farZ) * ppw + (float) target.width / 2;
+			float bottom = min((c.y - r) / nearZ, (c.y - r) / farZ) * ppw + (float) target.height / 2;
+			float top = max((c.y + r) / nearZ, (c.y + r) / farZ) * ppw + (float) target.height / 2;
+			if (right < 0 || left >= (float) target.width || top < 0 || bottom >= (float) target.height) {
+				continue;
+			}
+			xMin = (int) max(left, 0.0f) / tileSize;
+			xMax = (int) min(right, (float) target.width - 1) / tileSize;
+			yMin = (int) max(bottom, 0.0f) / tileSize;
+			yMax = (int) min(top, (float) target.height - 1) / tileSize;
+		}
+
+		for (int ty = yMin; ty <= yMax; ty++) {
+			for (int tx = xMin; tx <= xMax; tx++) {
+				bins[ty * tilesX + tx].push_back(l);
+			}
+		}
+	}
+
+	// flatten the bins so each tile's lights are a contiguous range
+	view.tilesX = tilesX;
+	view.tilesY = tilesY;
+	view.tileStart.assign(tilesX * tilesY + 1, 0);
+	view.tileLights.clear();
+	for (int t = 0; t < tilesX * tilesY; t++) {
+		view.tileLights.insert(view.tileLights.end(), bins[t].begin(), bins[t].end());
+		view.tileStart[t + 1] = (int) view.tileLights.size();
+	}
+}
+
+void Renderer::setLights(View &view) const {
+	view.lights = scene.lights;
+	view.ambient = scene.ambient;
+	view.directionalLights.clear();
+	for (int l = 0; l < (int) scene.lights.size(); l++) {
+		if (scene.lights[l].type == LightType::Directional) {
+			view.directionalLights.push_back(l);
+		}
+	}
+}
+
+float3 Renderer::illuminate(const View &view, const float3 &p, const float3 &n, const int *lights,
+							int numLights) const {
+	float3 total = view.ambient;
+	for (int l: view.directionalLights) {
+		total += view.lights[l].illuminate(p, n);
+	}
+	for (int l = 0; l < numLights; l++) {
+		total += view.lights[lights[l]].illuminate(p, n);
+	}
+	return total;
+}
 
-		// convert from local to world coordinates
-		float3 p1World = o.localToWorld(o.points[3 * i + 0]);
-		float3 p2World = o.localToWorld(o.points[3 * i + 1]);
-		float3 p3World = o.localToWorld(o.points[3 * i + 2]);
+// a meshlet can be skipped if every triangle in it is back facing, or its bounding sphere is outside the view
+bool Renderer::meshletVisible(const View &view, const Meshlet &m) const {
+	// every triangle is back facing if the camera sees the cone apex from within the cone's back side
+	if (m.coneCutoff <= 1) {
+		float3 toApex = m.coneApex - view.camera.offset;
+		if (dot(toApex, m.coneAxis) >= m.coneCutoff * length(toApex)) {
+			return false;
+		}
+	}
+	return view.sphereVisible(m.center, m.radius);
+}
 
-		// convert from world to screen coordinates, storing inverse z in the last coordinate
-		float3 p1Screen = worldToScreen(p1World);
-		float3 p2Screen = worldToScreen(p2World);
-		float3 p3Screen = worldToScreen(p3World);
+void Renderer::setupObject(WorldObject &w, const Object &o, const vector<View> &views) const {
+	w.object = &o;
+	w.boundsCenter = o.localToWorld(o.boundsCenter);
+	w.boundsRadius = o.boundsRadius * o.scale;
 
-		// orthogonal projection of screen space onto 2d space
-		float2 p1 = float2(p1Screen.x, p1Screen.y);
-		float2 p2 = float2(p2Screen.x, p2Screen.y);
-		float2 p3 = float2(p3Screen.x, p3Screen.y);
+	w.meshlets = o.meshlets;
+	for (Meshlet &m: w.meshlets) {
+		m.center = o.localToWorld(m.center);
+		m.radius *= o.scale;
+		m.coneApex = o.localToWorld(m.coneApex);
+		m.coneAxis = o.rotation.apply(m.coneAxis);
+	}
 
-		// back face culling
-		float total = edgeFunc(p1, p2, p3);
-		if (total <= 0) {
+	w.visible.resize(views.size());
+	for (size_t v = 0; v < views.size(); v++) {
+		w.visible[v].resize(w.meshlets.size());
+		for (size_t m = 0; m < w.meshlets.size(); m++) {
+			w.visible[v][m] = !clusterCulling || meshletVisible(views[v], w.meshlets[m]);
+		}
+	}
+
+	// gouraud shaded objects light their vertices with every local light touching the object's bounds
+	// the lights are the same in every view, so the first one's are used
+	bool perVertex = o.shading == ShadingMode::Gouraud && !views.empty();
+	vector<int> objectLights;
+	if (perVertex) {
+		for (int l = 0; l < (int) views[0].lights.size(); l++) {
+			const Light &light = views[0].lights[l];
+			if (light.type != LightType::Directional &&
+				length(light.position - w.boundsCenter) < light.range + w.boundsRadius) {
+				objectLights.push_back(l);
+			}
+		}
+	}
+
+	int numVertices = o.numVertices();
+	w.points.resize(numVertices);
+	w.normals.resize(numVertices);
+	w.vertexLighting.resize(perVertex ? numVertices : 0);
+	w.uvCoords.resize(o.quantized() ? numVertices : 0);
+	w.transformed.assign(numVertices, false);
+	for (size_t m = 0; m < w.meshlets.size(); m++) {
+		bool anyVisible = false;
+		for (size_t v = 0; v < views.size(); v++) {
+			anyVisible = anyVisible || w.visible[v][m];
+		}
+		if (!anyVisible) {
 			continue;
 		}
 
-		// find the bounding box of the given triangle
-		auto [xMin, xMax, yMin, yMax] = getBoundingBox(p1, p2, p3, target);
-
-		// loop over the bounding box and draw each pixel
-		for (int row = yMin; row < yMax; row++) {
-			for (int col = xMin; col < xMax; col++) {
-				float2 a(col + 0.5f, row + 0.5f);
-
-				// get the barycentric coordinates (don't normalize until we know we are in the triangle)
-				float b1 = edgeFunc(p2, p3, a);
-				float b2 = edgeFunc(p3, p1, a);
-				float b3 = edgeFunc(p1, p2, a);
-				if (b1 >= 0 && b2 >= 0 && b3 >= 0) {
-					b1 /= total;
-					b2 /= total;
-					b3 /= total;
-
-					// compute the perspective barycentric coordinates
-					float l1 = b1*p1Screen.z;
-					float l2 = b2*p2Screen.z;
-					float l3 = b3*p3Screen.z;
-
-					// compute the z coordinate
-					float zInv = l1 + l2 + l3;
-
-					if (zInv > target.zBuffer[row * target.width + col]) {
-						target.zBuffer[target.width * row + col] = zInv;
-
-//						// texturing using vertex colors
-//						float3 color = o.vertexColors[3 * i + 0] * b1 + o.vertexColors[3 * i + 1] * b2 + o.vertexColors[3 * i + 2] * b3;
-
-						// texturing using UVs
-						float2 uvSample = o.uvCoords[3*i+0]*l1 + o.uvCoords[3*i+1]*l2 + o.uvCoords[3*i+2]*l3;
-						uvSample /= zInv;
-						float3 color = o.texture.sample(uvSample);
-
-						// using normal, compute shading level
-						float3 normal1World = o.rotation.apply(o.normals[3 * i + 0]);
-						float3 normal2World = o.rotation.apply(o.normals[3 * i + 1]);
-						float3 normal3World = o.rotation.apply(o.normals[3 * i + 2]);
-						float3 normal = normal1World * l1 + normal2World * l2 + normal3World * l3;
-						normal /= zInv;
-						normal.normalize();
-						float shading = min(max((float) 0, dot(normal, float3(0, 0, -1))), (float) 1);        // TODO maybe rethink this
-						shading = 0.5f * shading + 0.5f;
-						color *= shading;
-
-						target.frameBuffer[4 * (target.width * row + col) + 0] = (byte) color.z;
-						target.frameBuffer[4 * (target.width * row + col) + 1] = (byte) color.y;
-						target.frameBuffer[4 * (target.width * row + col) + 2] = (byte) color.x;
-						target.frameBuffer[4 * (target.width * row + col) + 3] = (byte) 255;
+		const Meshlet &meshlet = o.meshlets[m];
+		for (int c = 3 * meshlet.firstTriangle; c < 3 * (meshlet.firstTriangle + meshlet.numTriangles); c++) {
+			int v = o.indices[c];
+			if (w.transformed[v]) {
+				continue;
+			}
+			w.transformed[v] = true;
+
+			// decode and convert from local to world coordinates
+			w.points[v] = o.localToWorld(o.vertexPosition(v));
+			w.normals[v] = o.rotation.apply(o.vertexNormal(v));
+			if (o.quantized()) {
+				w.uvCoords[v] = o.vertexUV(v);
+			}
+			if (perVertex) {
+				float3 normal = w.normals[v];
+				normal.normalize();
+				w.vertexLighting[v] = illuminate(views[0], w.points[v], normal, objectLights.data(),
+												 (int) objectLights.size());
+			}
+		}
+	}
+}
+
+// the most recently projected vertices of one object, like the post transform cache on a gpu. Triangles are ordered
+// for vertex reuse and vertices are numbered in order of first use, so slots picked by the low bits of the index
+// rarely evict a vertex that is about to be used again
+class ProjectionCache {
+	static const int size = 32;
+	const View &view;
+	const WorldObject &w;
+	int vertices[size];
+	float3 screen[size];
+
+public:
+	ProjectionCache(const View &view, const WorldObject &w) : view(view), w(w) {
+		fill(vertices, vertices + size, -1);
+	}
+
+	float3 project(int v) {
+		int slot = v & (size - 1);
+		if (vertices[slot] != v) {
+			vertices[slot] = v;
+			screen[slot] = view.worldToScreen(w.points[v]);
+		}
+		return screen[slot];
+	}
+};
+
+// screen positions projected ahead of time by a pipelined frame's transform jobs, shared by all of its bands
+class ScreenPoints {
+	const float3 *screen;
+
+public:
+	explicit ScreenPoints(const vector<float3> &screen) : screen(screen.data()) {}
+
+	float3 project(int v) const {
+		return screen[v];
+	}
+};
+
+// rasterizes only into the z buffer, with no texturing, lighting or color writes
+void Renderer::drawObjectDepth(View &view, int viewIndex, const WorldObject &w) const {
+	ProjectionCache cache(view, w);
+	drawDepth(view, viewIndex, w, {0, 0, view.target.width, view.target.height}, cache, nullptr);
+}
+
+template<class Projection>
+void Renderer::drawDepth(View &view, int viewIndex, const WorldObject &w, const PixelRect &clip,
+						 Projection &projection, const PixelRect *meshletBounds) const {
+	RenderTarget &target = view.target;
+	const Object &o = *w.object;
+	for (size_t m = 0; m < w.meshlets.size(); m++) {
+		if (!w.visible[viewIndex][m]) {
+			continue;
+		}
+		if (meshletBounds && (meshletBounds[m].xMax <= clip.xMin || meshletBounds[m].xMin >= clip.xMax ||
+							  meshletBounds[m].yMax <= clip.yMin || meshletBounds[m].yMin >= clip.yMax)) {
+			continue;
+		}
+
+		const Meshlet &meshlet = o.meshlets[m];
+		for (int i = meshlet.firstTriangle; i < meshlet.firstTriangle + meshlet.numTriangles; i++) {
+			float3 p1Screen = projection.project(o.indices[3 * i + 0]);
+			float3 p2Screen = projection.project(o.indices[3 * i + 1]);
+			float3 p3Screen = projection.project(o.indices[3 * i + 2]);
+
+			float2 p1 = float2(p1Screen.x, p1Screen.y);
+			float2 p2 = float2(p2Screen.x, p2Screen.y);
+			float2 p3 = float2(p3Screen.x, p3Screen.y);
+
+			float total = edgeFunc(p1, p2, p3);
+			if (total <= 0) {
+				continue;
+			}
+
+			auto [xMin, xMax, yMin, yMax] = getBoundingBox(p1, p2, p3, target);
+			xMin = max(xMin, clip.xMin);
+			xMax = min(xMax, clip.xMax);
+			yMin = max(yMin, clip.yMin);
+			yMax = min(yMax, clip.yMax);
+			for (int row = yMin; row < yMax; row++) {
+				for (int col = xMin; col < xMax; col++) {
+					float2 a(col + 0.5f, row + 0.5f);
+					float b1 = edgeFunc(p2, p3, a);
+					float b2 = edgeFunc(p3, p1, a);
+					float b3 = edgeFunc(p1, p2, a);
+					if (b1 >= 0 && b2 >= 0 && b3 >= 0) {
+						b1 /= total;
+						b2 /= total;
+						b3 /= total;
+						float zInv = b1*p1Screen.z + b2*p2Screen.z + b3*p3Screen.z;
+
+						float &depth = target.zBuffer[row * target.width + col];
+						if (zInv > depth) {
+							depth = zInv;
+							if (view.objectIds) {
+								view.objectIds[row * target.width + col] = w.id;
+								view.triangleIds[row * target.width + col] = i;
+							}
+						}
 					}
 				}
 			}
@@ -139,10 +348,523 @@ void Renderer::drawObject(const Object& o) {
 	}
 }
 
-void Renderer::render() {
+// textures and lights one pixel of triangle i, given its perspective weighted barycentric coordinates
+void Renderer::shadePixel(View &view, const WorldObject &w, int i, int row, int col, float l1, float l2,
+						  float l3) const {
+	RenderTarget &target = view.target;
+	const Object &o = *w.object;
+	int v1 = o.indices[3 * i + 0];
+	int v2 = o.indices[3 * i + 1];
+	int v3 = o.indices[3 * i + 2];
+	float zInv = l1 + l2 + l3;
+	bool perVertex = o.shading == ShadingMode::Gouraud;
+
+//	// texturing using vertex colors
+//	float3 color = (o.vertexColors[v1] * l1 + o.vertexColors[v2] * l2 + o.vertexColors[v3] * l3) / zInv;
+
+	// texturing using UVs
+	const float2 *uvCoords = o.quantized() ? w.uvCoords.data() : o.uvCoords.data();
+	float2 uvSample = uvCoords[v1]*l1 + uvCoords[v2]*l2 + uvCoords[v3]*l3;
+	uvSample /= zInv;
+	float3 color = o.texture.sample(uvSample);
+
+	// lighting, either interpolated from the vertices or from the lights binned to this tile
+	float3 lighting;
+	if (perVertex) {
+		lighting = (w.vertexLighting[v1] * l1 + w.vertexLighting[v2] * l2 + w.vertexLighting[v3] * l3) / zInv;
+	} else {
+		float3 normal = w.normals[v1] * l1 + w.normals[v2] * l2 + w.normals[v3] * l3;
+		normal /= zInv;
+		normal.normalize();
+		float3 position = (w.points[v1] * l1 + w.points[v2] * l2 + w.points[v3] * l3) / zInv;
+		int tile = (row / tileSize) * view.tilesX + col / tileSize;
+		lighting = illuminate(view, position, normal, view.tileLights.data() + view.tileStart[tile],
+							  view.tileStart[tile + 1] - view.tileStart[tile]);
+	}
+	color = mul(color, lighting);
+
+	target.frameBuffer[4 * (target.width * row + col) + 0] = (byte) min(color.z, 255.0f);
+	target.frameBuffer[4 * (target.width * row + col) + 1] = (byte) min(color.y, 255.0f);
+	target.frameBuffer[4 * (target.width * row + col) + 2] = (byte) min(color.x, 255.0f);
+	target.frameBuffer[4 * (target.width * row + col) + 3] = (byte) 255;
+}
+
+void Renderer::drawObject(View &view, int viewIndex, const WorldObject &w) const {
+	RenderTarget &target = view.target;
+	const Object &o = *w.object;
+	ProjectionCache cache(view, w);
+
+	for (size_t m = 0; m < w.meshlets.size(); m++) {
+		// skip whole clusters that face away from the camera or lie outside the view
+		if (!w.visible[viewIndex][m]) {
+			continue;
+		}
+
+		const Meshlet &meshlet = o.meshlets[m];
+		for (int i = meshlet.firstTriangle; i < meshlet.firstTriangle + meshlet.numTriangles; i++) {
+			// convert from world to screen coordinates, storing inverse z in the last coordinate
+			float3 p1Screen = cache.project(o.indices[3 * i + 0]);
+			float3 p2Screen = cache.project(o.indices[3 * i + 1]);
+			float3 p3Screen = cache.project(o.indices[3 * i + 2]);
+
+			// orthogonal projection of screen space onto 2d space
+			float2 p1 = float2(p1Screen.x, p1Screen.y);
+			float2 p2 = float2(p2Screen.x, p2Screen.y);
+			float2 p3 = float2(p3Screen.x, p3Screen.y);
+
+			// back face culling
+			float total = edgeFunc(p1, p2, p3);
+			if (total <= 0) {
+				continue;
+			}
+
+			// find the bounding box of the given triangle
+			auto [xMin, xMax, yMin, yMax] = getBoundingBox(p1, p2, p3, target);
+
+			// loop over the bounding box and draw each pixel
+			for (int row = yMin; row < yMax; row++) {
+				for (int col = xMin; col < xMax; col++) {
+					float2 a(col + 0.5f, row + 0.5f);
+
+					// get the barycentric coordinates (don't normalize until we know we are in the triangle)
+					float b1 = edgeFunc(p2, p3, a);
+					float b2 = edgeFunc(p3, p1, a);
+					float b3 = edgeFunc(p1, p2, a);
+					if (b1 >= 0 && b2 >= 0 && b3 >= 0) {
+						b1 /= total;
+						b2 /= total;
+						b3 /= total;
+
+						// compute the perspective barycentric coordinates
+						float l1 = b1*p1Screen.z;
+						float l2 = b2*p2Screen.z;
+						float l3 = b3*p3Screen.z;
+
+						// compute the z coordinate
+						float zInv = l1 + l2 + l3;
+
+						float depth = target.zBuffer[row * target.width + col];
+						if (zInv > depth) {
+							target.zBuffer[target.width * row + col] = zInv;
+							shadePixel(view, w, i, row, col, l1, l2, l3);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+// lays down depth first, nearest objects first so later ones are mostly rejected
+void Renderer::drawDepthPrepass(View &view, int viewIndex) const {
+	vector<pair<float, const WorldObject *>> order;
+	for (const WorldObject &w: worldObjects) {
+		order.emplace_back(length(w.boundsCenter - view.camera.offset) - w.boundsRadius, &w);
+	}
+	sort(order.begin(), order.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+	for (const auto &[distance, w]: order) {
+		drawObjectDepth(view, viewIndex, *w);
+	}
+}
+
+void Renderer::renderView(View &view, int viewIndex) const {
+	buildLightTiles(view);
+	view.target.clear();
+
+	if (!zPrepass) {
+		for (const WorldObject &w: worldObjects) {
+			drawObject(view, viewIndex, w);
+		}
+		return;
+	}
+
+	// the prepass records which triangle won each pixel, and only that triangle is shaded. Re-testing depth for
+	// equality in a second raster pass breaks as soon as the compiler rounds the two depth computations differently
+	int numPixels = view.target.width * view.target.height;
+	vector<int> objectIds(numPixels, -1);
+	vector<int> triangleIds(numPixels);
+	view.objectIds = objectIds.data();
+	view.triangleIds = triangleIds.data();
+	drawDepthPrepass(view, viewIndex);
+
+	VisibleTriangle last;
+	for (int row = 0; row < view.target.height; row++) {
+		for (int col = 0; col < view.target.width; col++) {
+			if (objectIds[row * view.target.width + col] >= 0) {
+				shadeVisible(view, worldObjects, row, col, last);
+			}
+		}
+	}
+	view.objectIds = nullptr;
+	view.triangleIds = nullptr;
+}
+
+// shades a pixel from the triangle the depth pass left there, the same way drawObject would have
+void Renderer::shadeVisible(View &view, const vector<WorldObject> &objects, int row, int col,
+							VisibleTriangle &last) const {
+	int p = row * view.target.width + col;
+	int id = view.objectIds[p];
+	int i = view.triangleIds[p];
+	const WorldObject &w = objects[id];
+	if (id != last.id || i != last.triangle) {
+		const Object &o = *w.object;
+		last.p1Screen = view.worldToScreen(w.points[o.indices[3 * i + 0]]);
+		last.p2Screen = view.worldToScreen(w.points[o.indices[3 * i + 1]]);
+		last.p3Screen = view.worldToScreen(w.points[o.indices[3 * i + 2]]);
+		last.p1 = float2(last.p1Screen.x, last.p1Screen.y);
+		last.p2 = float2(last.p2Screen.x, last.p2Screen.y);
+		last.p3 = float2(last.p3Screen.x, last.p3Screen.y);
+		last.total = edgeFunc(last.p1, last.p2, last.p3);
+		last.id = id;
+		last.triangle = i;
+	}
+	float2 a(col + 0.5f, row + 0.5f);
+	float b1 = edgeFunc(last.p2, last.p3, a) / last.total;
+	float b2 = edgeFunc(last.p3, last.p1, a) / last.total;
+	float b3 = edgeFunc(last.p1, last.p2, a) / last.total;
+	shadePixel(view, w, i, row, col, b1 * last.p1Screen.z, b2 * last.p2Screen.z, b3 * last.p3Screen.z);
+}
+
+static bool sameFloat3(const float3 &a, const float3 &b) {
+	return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+static const void *textureData(const Texture &texture) {
+	return texture.image ? (const void *) texture.image : (const void *) texture.blocks.get();
+}
+
+bool Renderer::compareHistory(vector<char> &changed) const {
+	if (!historyValid || (int) previousIds.size() != target.width * target.height ||
+		previousObjects.size() != scene.objects.size() || previousCamera.fov != scene.camera.fov) {
+		return false;
+	}
+
+	// shading only depends on the lights and the surface, so any change to the lights invalidates every pixel
+	if (!sameFloat3(previousAmbient, scene.ambient) || previousLights.size() != scene.lights.size()) {
+		return false;
+	}
+	for (size_t l = 0; l < scene.lights.size(); l++) {
+		const Light &a = previousLights[l];
+		const Light &b = scene.lights[l];
+		if (a.type != b.type || !sameFloat3(a.position, b.position) || !sameFloat3(a.direction, b.direction) ||
+			!sameFloat3(a.color, b.color) || a.range != b.range || a.innerCone != b.innerCone ||
+			a.outerCone != b.outerCone) {
+			return false;
+		}
+	}
+
+	changed.assign(scene.objects.size(), false);
+	for (size_t i = 0; i < scene.objects.size(); i++) {
+		const Object &o = scene.objects[i];
+		const ObjectHistory &h = previousObjects[i];
+		changed[i] = !sameFloat3(h.offset, o.offset) || !sameFloat3(h.rotation.i, o.rotation.i) ||
+					 !sameFloat3(h.rotation.j, o.rotation.j) || !sameFloat3(h.rotation.k, o.rotation.k) ||
+					 h.scale != o.scale || h.mesh != o.indices.data() || h.texture != textureData(o.texture) ||
+					 h.shading != o.shading;
+	}
+	return true;
+}
+
+// every covered pixel is traced back into the last frame through the depth buffer and the two cameras. If the same
+// object is found there at the same depth its color is copied over, otherwise the pixel is shaded from the triangle
+// the depth pass found, so nothing is rasterized twice
+void Renderer::renderTemporal(View &view) {
+	RenderTarget &target = view.target;
+	int numPixels = target.width * target.height;
+	vector<char> changed;
+	bool reuse = compareHistory(changed);
+
+	swap(previousIds, objectIds);
+	swap(previousAges, ages);
+	swap(previousDrift, drift);
+	objectIds.assign(numPixels, -1);
+	triangleIds.resize(numPixels);
+	ages.resize(numPixels);
+	drift.resize(numPixels);
+
+	// visibility first, so each pixel knows which triangle it shows before anything is shaded
+	buildLightTiles(view);
 	target.clear();
-	for (Object &o: scene.objects) {
-		drawObject(o);
+	view.objectIds = objectIds.data();
+	view.triangleIds = triangleIds.data();
+	drawDepthPrepass(view, 0);
+
+	const float depthTolerance = 0.01f;		// relative difference in inverse depth still treated as the same surface
+	int maxAge = clamp(maxReuseAge, 0, 255);
+	float ppw = view.pixelsPerWorldUnit;
+	float halfWidth = (float) target.width / 2;
+	float halfHeight = (float) target.height / 2;
+
+	// this frame's view space to the last frame's, so reprojecting a pixel is a single matrix multiply
+	const Rotation &previousRotation = previousCamera.rotation;
+	float3 toPreviousX = previousRotation.applyInv(view.camera.rotation.i);
+	float3 toPreviousY = previousRotation.applyInv(view.camera.rotation.j);
+	float3 toPreviousZ = previousRotation.applyInv(view.camera.rotation.k);
+	float3 toPreviousOffset = previousRotation.applyInv(view.camera.offset - previousCamera.offset);
+
+	VisibleTriangle last;
+
+	for (int row = 0; row < target.height; row++) {
+		for (int col = 0; col < target.width; col++) {
+			int p = row * target.width + col;
+			int id = objectIds[p];
+			if (id < 0) {
+				continue;		// background, already cleared
+			}
+
+			if (reuse && !changed[id]) {
+				float z = 1 / target.zBuffer[p];
+				float3 direction = toPreviousX * ((col + 0.5f - halfWidth) / ppw) +
+								   toPreviousY * ((row + 0.5f - halfHeight) / ppw) + toPreviousZ;
+				float3 q = direction * z + toPreviousOffset;
+				float qCol = q.x * ppw / q.z + halfWidth;
+				float qRow = q.y * ppw / q.z + halfHeight;
+				if (q.z > 0 && qCol >= 0 && qRow >= 0 && qCol < (float) target.width && qRow < (float) target.height) {
+					int qp = (int) qRow * target.width + (int) qCol;
+					float qInv = 1 / q.z;
+
+					// copying the nearest pixel is off by a fraction of a pixel, and copies of copies add up, so
+					// the offset is carried along and the pixel is shaded again once it gets too large
+					float driftX = previousDrift[qp].x + floorf(qCol) + 0.5f - qCol;
+					float driftY = previousDrift[qp].y + floorf(qRow) + 0.5f - qRow;
+					if (previousIds[qp] == id && fabsf(previousDepth[qp] - qInv) <= depthTolerance * qInv &&
+						previousAges[qp] + 1 < maxAge && fabsf(driftX) <= maxReuseDrift &&
+						fabsf(driftY) <= maxReuseDrift) {
+						ages[p] = previousAges[qp] + 1;
+						drift[p] = float2(driftX, driftY);
+						for (int c = 0; c < 4; c++) {
+							target.frameBuffer[4 * p + c] = previousColor[4 * qp + c];
+						}
+						continue;
+					}
+				}
+			}
+
+			shadeVisible(view, worldObjects, row, col, last);
+
+			// fresh pixels start at a staggered age, so they don't all expire on the same frame
+			ages[p] = (uint8_t) (((unsigned int) p * 2654435761u >> 24) % (maxAge / 2 + 1));
+			drift[p] = float2(0, 0);
+		}
+	}
+	view.objectIds = nullptr;
+	view.triangleIds = nullptr;
+
+	// history is copied out rather than read back from the target next frame, since the caller may hand the
+	// renderer a different target each frame
+	previousColor.assign(target.frameBuffer, target.frameBuffer + 4 * numPixels);
+	previousDepth.assign(target.zBuffer, target.zBuffer + numPixels);
+
+	historyValid = true;
+	previousCamera = view.camera;
+	previousLights = scene.lights;
+	previousAmbient = scene.ambient;
+	previousObjects.clear();
+	for (const Object &o: scene.objects) {
+		previousObjects.push_back({o.offset, o.rotation, o.scale, o.indices.data(), textureData(o.texture), o.shading});
+	}
+}
+
+void Renderer::invalidateHistory() {
+	historyValid = false;
+}
+
+void Renderer::render() {
+	scene.graph.update(scene.objects);
+
+	vector<View> views = {View(scene.camera, target)};
+	setLights(views[0]);
+	worldObjects.resize(scene.objects.size());
+	for (size_t i = 0; i < scene.objects.size(); i++) {
+		worldObjects[i].id = (int) i;
+		setupObject(worldObjects[i], scene.objects[i], views);
+	}
+
+	if (temporalReuse) {
+		renderTemporal(views[0]);
+	} else {
+		historyValid = false;
+		renderView(views[0], 0);
+	}
+}
+
+void Renderer::renderViews(const vector<Camera> &cameras, const vector<RenderTarget> &targets) {
+	scene.graph.update(scene.objects);
+	if (!pool) {
+		pool = make_unique<ThreadPool>();
+	}
+
+	vector<View> views;
+	for (size_t v = 0; v < min(cameras.size(), targets.size()); v++) {
+		views.emplace_back(cameras[v], targets[v]);
+		setLights(views.back());
+	}
+
+	// per object work is shared by the whole batch, then every view rasterizes on its own
+	worldObjects.resize(scene.objects.size());
+	vector<future<void>> jobs;
+	for (size_t i = 0; i < scene.objects.size(); i++) {
+		worldObjects[i].id = (int) i;
+		jobs.push_back(pool->submit([this, i, &views] { setupObject(worldObjects[i], scene.objects[i], views); }));
+	}
+	for (future<void> &job: jobs) {
+		job.get();
+	}
+
+	jobs.clear();
+	for (size_t v = 0; v < views.size(); v++) {
+		jobs.push_back(pool->submit([this, v, &views] { renderView(views[v], (int) v); }));
+	}
+	for (future<void> &job: jobs) {
+		job.get();
 	}
 }
 
+PipelinedFrame::PipelinedFrame(int width, int height) : target(width, height) {}
+
+void PipelinedFrame::wait() {
+	if (graph) {
+		graph->wait();
+	}
+}
+
+void Renderer::projectObject(PipelinedFrame &frame, int index) const {
+	const View &view = frame.views[0];
+	const WorldObject &w = frame.worldObjects[index];
+	const Object &o = *w.object;
+	vector<float3> &screen = frame.screenPoints[index];
+	vector<PixelRect> &bounds = frame.meshletBounds[index];
+	screen.resize(w.points.size());
+	bounds.resize(w.meshlets.size());
+
+	// setupObject has already marked every vertex of a visible meshlet
+	for (size_t v = 0; v < w.points.size(); v++) {
+		if (w.transformed[v]) {
+			screen[v] = view.worldToScreen(w.points[v]);
+		}
+	}
+
+	// rounded the same way as each triangle's bounding box, and the whole screen if any vertex is behind the camera
+	for (size_t m = 0; m < w.meshlets.size(); m++) {
+		if (!w.visible[0][m]) {
+			continue;
+		}
+		const Meshlet &meshlet = o.meshlets[m];
+		float xMin = INFINITY, xMax = -INFINITY, yMin = INFINITY, yMax = -INFINITY;
+		bool behind = false;
+		for (int c = 3 * meshlet.firstTriangle; c < 3 * (meshlet.firstTriangle + meshlet.numTriangles); c++) {
+			const float3 &p = screen[o.indices[c]];
+			behind = behind || p.z <= 0 || !isfinite(p.z);
+			xMin = min(xMin, p.x);
+			xMax = max(xMax, p.x);
+			yMin = min(yMin, p.y);
+			yMax = max(yMax, p.y);
+		}
+		float width = (float) view.target.width;
+		float height = (float) view.target.height;
+		if (behind) {
+			bounds[m] = {0, 0, view.target.width, view.target.height};
+		} else {
+			bounds[m] = {(int) clamp(xMin, -1.0f, width), (int) clamp(yMin, -1.0f, height),
+						 (int) clamp(xMax, -1.0f, width) + 1, (int) clamp(yMax, -1.0f, height) + 1};
+		}
+	}
+}
+
+void Renderer::rasterBand(PipelinedFrame &frame, const PixelRect &band) const {
+	View &view = frame.views[0];
+	RenderTarget &target = view.target;
+	int width = band.xMax - band.xMin;
+	for (int row = band.yMin; row < band.yMax; row++) {
+		int first = row * target.width + band.xMin;
+		byte *color = target.frameBuffer + 4 * first;
+		for (int col = 0; col < width; col++) {
+			color[4 * col + 0] = (byte) 0;
+			color[4 * col + 1] = (byte) 0;
+			color[4 * col + 2] = (byte) 0;
+			color[4 * col + 3] = (byte) 255;
+		}
+		fill(target.zBuffer + first, target.zBuffer + first + width, 0.0f);
+		fill(view.objectIds + first, view.objectIds + first + width, -1);
+	}
+
+	for (const WorldObject *w: frame.drawOrder) {
+		ScreenPoints projection(frame.screenPoints[w->id]);
+		drawDepth(view, 0, *w, band, projection, frame.meshletBounds[w->id].data());
+	}
+}
+
+void Renderer::resolveBand(PipelinedFrame &frame, const PixelRect &band) const {
+	View &view = frame.views[0];
+	VisibleTriangle last;
+	for (int row = band.yMin; row < band.yMax; row++) {
+		for (int col = band.xMin; col < band.xMax; col++) {
+			if (view.objectIds[row * view.target.width + col] >= 0) {
+				shadeVisible(view, frame.worldObjects, row, col, last);
+			}
+		}
+	}
+}
+
+void Renderer::renderFrame(PipelinedFrame &frame, JobSystem &jobs, function<void(const RenderTarget &)> encode) {
+	// the frame's buffers are still in use until its last run finishes
+	frame.wait();
+	scene.graph.update(scene.objects);
+
+	RenderTarget &target = frame.target;
+	frame.views = {View(scene.camera, target)};
+	setLights(frame.views[0]);
+	frame.objectIds.resize(target.width * target.height);
+	frame.triangleIds.resize(target.width * target.height);
+	frame.views[0].objectIds = frame.objectIds.data();
+	frame.views[0].triangleIds = frame.triangleIds.data();
+	frame.worldObjects.resize(scene.objects.size());
+	frame.screenPoints.resize(scene.objects.size());
+	frame.meshletBounds.resize(scene.objects.size());
+	frame.graph = make_unique<TaskGraph>();
+	TaskGraph &graph = *frame.graph;
+
+	int lightTiles = graph.add([this, &frame] { buildLightTiles(frame.views[0]); });
+
+	// once every object is in world space they are sorted nearest first for the depth pass
+	frame.posed = graph.add([&frame] {
+		const Camera &camera = frame.views[0].camera;
+		vector<pair<float, const WorldObject *>> order;
+		for (const WorldObject &w: frame.worldObjects) {
+			order.emplace_back(length(w.boundsCenter - camera.offset) - w.boundsRadius, &w);
+		}
+		sort(order.begin(), order.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+		frame.drawOrder.clear();
+		for (const auto &[distance, w]: order) {
+			frame.drawOrder.push_back(w);
+		}
+	});
+	for (size_t i = 0; i < scene.objects.size(); i++) {
+		int transform = graph.add([this, &frame, i] {
+			frame.worldObjects[i].id = (int) i;
+			setupObject(frame.worldObjects[i], scene.objects[i], frame.views);
+			projectObject(frame, (int) i);
+		});
+		graph.precede(transform, frame.posed);
+	}
+
+	int encoded = graph.add([&frame, encode = std::move(encode)] {
+		if (encode) {
+			encode(frame.target);
+		}
+	});
+
+	// each band is shaded as soon as its own depth pass is done, without waiting for the rest of the screen
+	for (int y = 0; y < target.height; y += bandHeight) {
+		PixelRect band = {0, y, target.width, min(y + bandHeight, target.height)};
+		int raster = graph.add([this, &frame, band] { rasterBand(frame, band); });
+		int resolve = graph.add([this, &frame, band] { resolveBand(frame, band); });
+		graph.precede(frame.posed, raster);
+		graph.precede(raster, resolve);
+		graph.precede(lightTiles, resolve);
+		graph.precede(resolve, encoded);
+	}
+
+	graph.run(jobs);
+	graph.wait(frame.posed);
+}
@@ -11,8 +11,12 @@
 #include <string>
 #include <sstream>
 #include <cstdlib>
+#include <memory>
+#include <cstdint>
 
 #include "scenes.h"
+#include "threadpool.h"
+#include "jobs.h"
 
 namespace nsGraphics {
 
@@ -28,21 +32,199 @@ namespace nsGraphics {
 		void clear();
 	};
 
-	class Renderer {
+	// a camera and the target it draws into, along with the lights binned to its screen tiles this frame
+	class View {
+	public:
+		Camera camera;
+		RenderTarget target;
 		float pixelsPerWorldUnit;
+
+		int tilesX = 0;
+		int tilesY = 0;
+		std::vector<int> tileStart;
+		std::vector<int> tileLights;
+
+		// copied from the scene when the view is set up, so a frame still being drawn never reads lights that are
+		// being changed for the next one
+		std::vector<Light> lights;
+		std::vector<int> directionalLights;		// reach every pixel, so they aren't binned into tiles
+		float3 ambient;
+
+		// when set, the depth pass records which object and triangle ends up in front at each pixel
+		int *objectIds = nullptr;
+		int *triangleIds = nullptr;
+
+		View(const Camera &camera, RenderTarget target);
+
+		// converts from world space to screen space, storing inverse z coordinate in the third entry
+		[[nodiscard]] float3 worldToScreen(const float3 &p) const;
+
+		// false if the sphere is completely behind the camera or outside one of the side planes
+		[[nodiscard]] bool sphereVisible(const float3 &center, float radius) const;
+	};
+
+	// min inclusive, max exclusive
+	struct PixelRect {
+		int xMin;
+		int yMin;
+		int xMax;
+		int yMax;
+	};
+
+	// an object's geometry moved to world space. Built once per frame and shared by every view that draws it
+	class WorldObject {
+	public:
+		const Object *object = nullptr;
+		int id = 0;								// index of the object in the scene
+		std::vector<Meshlet> meshlets;			// bounds and cones in world space
+		std::vector<std::vector<char>> visible;	// which meshlets survived culling, per view
+		std::vector<float3> points;				// per vertex, only filled in for meshlets visible in some view
+		std::vector<float3> normals;
+		std::vector<float3> vertexLighting;		// per vertex, gouraud shaded objects only
+		std::vector<float2> uvCoords;			// per vertex, decoded for quantized objects only
+		std::vector<char> transformed;			// vertices already handled this frame
+		float3 boundsCenter;
+		float boundsRadius = 0;
+	};
+
+	// one frame's state while its jobs run, with its own target. Keeping two lets one frame be rasterized, shaded
+	// and encoded while the next one is posed and transformed
+	class PipelinedFrame {
+	public:
+		RenderTarget target;
+		std::vector<View> views;
+		std::vector<WorldObject> worldObjects;
+		std::vector<const WorldObject *> drawOrder;		// nearest first, for the depth pass
+		std::vector<std::vector<float3>> screenPoints;		// per object, projected once and shared by every band
+		std::vector<std::vector<PixelRect>> meshletBounds;	// per object, screen bounds of each visible meshlet
+		std::vector<int> objectIds;
+		std::vector<int> triangleIds;
+		std::unique_ptr<TaskGraph> graph;
+		int posed = -1;			// job that finishes once every object has been transformed
+
+		PipelinedFrame(int width, int height);
+
+		// blocks until everything from the last frame rendered with this one, including its encode, has finished
+		void wait();
+	};
+
+	class Renderer {
+		static const int tileSize = 16;
+		static const int bandHeight = 32;	// rows in each strip of the screen rasterized and shaded as a separate job
+		std::vector<WorldObject> worldObjects;
+		std::unique_ptr<ThreadPool> pool;		// created the first time several views are rendered
+
+		// what the previous frame saw, for temporal reuse
+		struct ObjectHistory {
+			float3 offset;
+			Rotation rotation;
+			float scale;
+			const void *mesh;
+			const void *texture;
+			ShadingMode shading;
+		};
+		bool historyValid = false;
+		Camera previousCamera;
+		std::vector<ObjectHistory> previousObjects;
+		std::vector<Light> previousLights;
+		float3 previousAmbient;
+		std::vector<std::byte> previousColor;
+		std::vector<float> previousDepth;
+		std::vector<int> previousIds;
+		std::vector<int> objectIds;
+		std::vector<int> triangleIds;
+		std::vector<uint8_t> previousAges;
+		std::vector<uint8_t> ages;				// frames since each pixel was last shaded
+		std::vector<float2> previousDrift;
+		std::vector<float2> drift;				// offset in pixels from each pixel's center to where its color was shaded
+
+		void buildLightTiles(View &view) const;
+
+		// copies the scene's lights into the view
+		void setLights(View &view) const;
+
+		// ambient plus every directional light plus the given point and spot lights, all taken from the view
+		[[nodiscard]] float3 illuminate(const View &view, const float3 &p, const float3 &n, const int *lights,
+										int numLights) const;
+
+		[[nodiscard]] bool meshletVisible(const View &view, const Meshlet &m) const;
+
+		// moves o to world space, culling its meshlets against every view and only transforming what survives
+		void setupObject(WorldObject &w, const Object &o, const std::vector<View> &views) const;
+
+		void drawDepthPrepass(View &view, int viewIndex) const;
+
+		// depth pass limited to the pixels in clip. Projection supplies screen positions of vertices, and meshlets
+		// whose bounds miss clip are skipped when meshletBounds is given
+		template<class Projection>
+		void drawDepth(View &view, int viewIndex, const WorldObject &w, const PixelRect &clip, Projection &projection,
+					   const PixelRect *meshletBounds) const;
+
+		void shadePixel(View &view, const WorldObject &w, int i, int row, int col, float l1, float l2, float l3) const;
+
+		// the triangle shaded last from the depth pass's ids. Neighbouring pixels mostly show the same triangle,
+		// so its screen positions are kept between pixels
+		struct VisibleTriangle {
+			int id = -1;
+			int triangle = -1;
+			float3 p1Screen, p2Screen, p3Screen;
+			float2 p1, p2, p3;
+			float total = 0;
+		};
+
+		void shadeVisible(View &view, const std::vector<WorldObject> &objects, int row, int col,
+						  VisibleTriangle &last) const;
+
+		// projects the vertices of one of a frame's objects to the screen and finds the bounds of its meshlets
+		void projectObject(PipelinedFrame &frame, int index) const;
+
+		// clears one band of rows and runs the depth pass over it, recording the triangle in front at each pixel
+		void rasterBand(PipelinedFrame &frame, const PixelRect &band) const;
+
+		// shades every covered pixel in a band from the ids rasterBand left
+		void resolveBand(PipelinedFrame &frame, const PixelRect &band) const;
+
+		void renderView(View &view, int viewIndex) const;
+
+		// finds which objects moved or changed since the last frame, returns false if nothing can be reused
+		bool compareHistory(std::vector<char> &changed) const;
+
+		void renderTemporal(View &view);
+
 	public:
 		Scene scene;
 		RenderTarget target;
+		bool clusterCulling = true;		// reject meshlets by their normal cone and bounds before drawing
+		bool zPrepass = false;			// fill the z buffer first so each pixel is only shaded once
+		bool temporalReuse = false;		// reproject the last frame's shading, only shading pixels that changed
+		int maxReuseAge = 8;			// frames a pixel can be reused for before it is shaded again
+		float maxReuseDrift = 0.0625f;	// pixels a reused color may have wandered from where it was shaded
 
 		Renderer(const Scene& scene, RenderTarget target);
 
 		[[nodiscard]] float3 worldToScreen(const float3 &p) const;
 
-		void drawObject(const Object &o);
+		// depth only rasterization, used by the prepass
+		void drawObjectDepth(View &view, int viewIndex, const WorldObject &w) const;
+
+		void drawObject(View &view, int viewIndex, const WorldObject &w) const;
 
 		void render();
+
+		// shades every pixel on the next frame, for changes temporal reuse can't detect (such as editing a texture)
+		void invalidateHistory();
+
+		// renders the scene from each camera into the matching target. Objects are transformed and culled once for
+		// the whole batch and the views are rasterized in parallel
+		void renderViews(const std::vector<Camera> &cameras, const std::vector<RenderTarget> &targets);
+
+		// renders the scene into frame as a graph of jobs: per object transform and culling, then a depth pass and a
+		// shading pass per band of rows, then encode (which may be empty) once every band is shaded. Returns as soon
+		// as every object has been transformed, so the scene can be posed for the next frame while this one is still
+		// being drawn. Lights are copied into the frame, but meshes and textures must not change while it is in flight
+		void renderFrame(PipelinedFrame &frame, JobSystem &jobs, std::function<void(const RenderTarget &)> encode);
 	};
 
 }
 
-#endif //RENDERINGPROJECT_RENDERER_H
\ No newline at end of file
+#endif //RENDERINGPROJECT_RENDERER_H
@@ -0,0 +1,123 @@
+/*
+ * Author: Nate Shaffer
+ * Email: nshaffe4@u.rochester.edu
+ * Date Created: 10/18/2026
+ *
+ * Scene graph with parent/child transforms, world transforms are cached and only recomputed when they change
+ */
+
+#include "scenegraph.h"
+#include "scenes.h"
+
+using namespace std;
+using namespace nsGraphics;
+
+Transform::Transform() : offset(float3()), rotation(Rotation()), scale(1) {}
+
+Transform::Transform(float3 offset, Rotation rotation, float scale) : offset(offset), rotation(rotation),
+																	  scale(scale) {}
+
+float3 Transform::apply(const float3 &p) const {
+	float3 pWorld = rotation.apply(p);
+	pWorld *= scale;
+	pWorld += offset;
+	return pWorld;
+}
+
+Transform Transform::operator*(const Transform &child) const {
+	return {apply(child.offset), rotation * child.rotation, scale * child.scale};
+}
+
+int SceneGraph::addNode(const string &name, int parent, const Transform &local) {
+	int node = size();
+	names.push_back(name);
+	parents.push_back(parent);
+	localTransforms.push_back(local);
+	worldTransforms.push_back(parent < 0 ? local : worldTransforms[parent] * local);
+	objectIndices.push_back(-1);
+	spinRates.push_back(0);
+	dirty.push_back(true);
+	moved.push_back(false);
+	return node;
+}
+
+int SceneGraph::find(const string &name) const {
+	for (int node = 0; node < size(); node++) {
+		if (names[node] == name) {
+			return node;
+		}
+	}
+	return -1;
+}
+
+int SceneGraph::size() const {
+	return (int) parents.size();
+}
+
+int SceneGraph::parent(int node) const {
+	return parents[node];
+}
+
+const Transform &SceneGraph::local(int node) const {
+	return localTransforms[node];
+}
+
+const Transform &SceneGraph::world(int node) const {
+	return worldTransforms[node];
+}
+
+Transform &SceneGraph::edit(int node) {
+	dirty[node] = true;
+	return localTransforms[node];
+}
+
+void SceneGraph::attach(int node, int objectIndex) {
+	objectIndices[node] = objectIndex;
+	dirty[node] = true;
+}
+
+int SceneGraph::object(int node) const {
+	return objectIndices[node];
+}
+
+void SceneGraph::setSpin(int node, float radiansPerSecond) {
+	spinRates[node] = radiansPerSecond;
+}
+
+void SceneGraph::animate(float dt) {
+	for (int node = 0; node < size(); node++) {
+		if (spinRates[node] != 0) {
+			edit(node).rotation.addYaw(spinRates[node] * dt);
+		}
+	}
+}
+
+int SceneGraph::update() {
+	int recomputed = 0;
+	for (int node = 0; node < size(); node++) {
+		int p = parents[node];
+		moved[node] = dirty[node] || (p >= 0 && moved[p]);
+		if (!moved[node]) {
+			continue;
+		}
+
+		worldTransforms[node] = p < 0 ? localTransforms[node] : worldTransforms[p] * localTransforms[node];
+		dirty[node] = false;
+		recomputed++;
+	}
+	return recomputed;
+}
+
+int SceneGraph::update(vector<Object> &objects) {
+	int recomputed = update();
+	for (int node = 0; node < size(); node++) {
+		int objectIndex = objectIndices[node];
+		if (moved[node] && objectIndex >= 0 && objectIndex < (int) objects.size()) {
+			Object &o = objects[objectIndex];
+			o.offset = worldTransforms[node].offset;
+			o.rotation = worldTransforms[node].rotation;
+			o.scale = worldTransforms[node].scale;
+		}
+	}
+	return recomputed;
+}
@@ -0,0 +1,83 @@
+//
+// Created by nates on 10/18/2026.
+//
+
+#ifndef RENDERINGPROJECT_SCENEGRAPH_H
+#define RENDERINGPROJECT_SCENEGRAPH_H
+
+#include <string>
+#include <vector>
+#include "maths.h"
+
+namespace nsGraphics {
+
+	class Object;
+
+	// rotation, then uniform scale, then offset, the same order as Object::localToWorld
+	class Transform {
+	public:
+		float3 offset;
+		Rotation rotation;
+		float scale;
+
+		Transform();
+
+		Transform(float3 offset, Rotation rotation, float scale);
+
+		[[nodiscard]] float3 apply(const float3 &p) const;
+
+		// transform that applies child first and then this one
+		Transform operator*(const Transform &child) const;
+	};
+
+	// hierarchy of transforms stored as parallel arrays, with every parent ahead of its children. A single
+	// forward sweep is then enough to update world transforms, and only nodes whose local transform changed (or
+	// whose parent moved) are recomputed
+	class SceneGraph {
+		std::vector<std::string> names;
+		std::vector<int> parents;
+		std::vector<Transform> localTransforms;
+		std::vector<Transform> worldTransforms;
+		std::vector<int> objectIndices;		// object in the scene driven by each node, or -1
+		std::vector<float> spinRates;		// yaw in radians per second, used by animate
+		std::vector<char> dirty;
+		std::vector<char> moved;			// world transform changed during the current update
+
+	public:
+		// parent must already be in the graph, or -1 for a root
+		int addNode(const std::string &name, int parent, const Transform &local);
+
+		// returns -1 if no node has the given name
+		[[nodiscard]] int find(const std::string &name) const;
+
+		[[nodiscard]] int size() const;
+
+		[[nodiscard]] int parent(int node) const;
+
+		[[nodiscard]] const Transform &local(int node) const;
+
+		[[nodiscard]] const Transform &world(int node) const;
+
+		// gives write access to a node's local transform and flags it for the next update
+		Transform &edit(int node);
+
+		void attach(int node, int objectIndex);
+
+		// index of the object attached to a node, or -1
+		[[nodiscard]] int object(int node) const;
+
+		void setSpin(int node, float radiansPerSecond);
+
+		// advances the spin of every spinning node
+		void animate(float dt);
+
+		// recomputes the world transforms of changed subtrees. Returns the number of nodes that were recomputed
+		int update();
+
+		// same as update, and also copies the new transforms onto attached objects
+		int update(std::vector<Object> &objects);
+	};
+
+}
+
+#endif //RENDERINGPROJECT_SCENEGRAPH_H
@@ -6,6 +6,10 @@
  * Contains classes for objects, textures, as well as the scene and camera
  */
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
 #include "scenes.h"
 
 using namespace std;
@@ -26,6 +30,45 @@ vector<string> splitString(string s, string delimiter) {
 	return res;
 }
 
+// turns the per corner attributes into shared vertices, corners matching in every attribute are merged
+static void weldCorners(Object &o) {
+	int numCorners = 3 * o.numTriangles;
+	bool hasColors = (int) o.vertexColors.size() == numCorners;
+	vector<array<float, 11>> keys(numCorners);
+	vector<int> corners(numCorners);
+	for (int c = 0; c < numCorners; c++) {
+		const float3 &p = o.points[c];
+		const float2 &uv = o.uvCoords[c];
+		const float3 &n = o.normals[c];
+		float3 color = hasColors ? o.vertexColors[c] : float3();
+		keys[c] = {p.x, p.y, p.z, uv.x, uv.y, n.x, n.y, n.z, color.x, color.y, color.z};
+		corners[c] = c;
+	}
+	sort(corners.begin(), corners.end(), [&keys](int a, int b) { return keys[a] < keys[b]; });
+
+	vector<float3> points;
+	vector<float2> uvCoords;
+	vector<float3> normals;
+	vector<float3> vertexColors;
+	o.indices.resize(numCorners);
+	for (int c = 0; c < numCorners; c++) {
+		int corner = corners[c];
+		if (c == 0 || keys[corners[c - 1]] != keys[corner]) {
+			points.push_back(o.points[corner]);
+			uvCoords.push_back(o.uvCoords[corner]);
+			normals.push_back(o.normals[corner]);
+			if (hasColors) {
+				vertexColors.push_back(o.vertexColors[corner]);
+			}
+		}
+		o.indices[corner] = (int) points.size() - 1;
+	}
+	o.points = std::move(points);
+	o.uvCoords = std::move(uvCoords);
+	o.normals = std::move(normals);
+	o.vertexColors = std::move(vertexColors);
+}
+
 Object::Object(int numTriangles, vector<float3> points, vector<float2> uvCoords, std::vector<float3> normals,
 			   vector<float3> vertexColors) :
 		numTriangles(numTriangles),
@@ -36,6 +79,9 @@ Object::Object(int numTriangles, vector<float3> points, vector<float2> uvCoords,
 		scale(1),
 		offset(float3()),
 		rotation(Rotation()) {
+	weldCorners(*this);
+	buildMeshlets();
+	optimizeMesh();
 }
 
 float3 Object::localToWorld(const float3 &p) const {
@@ -54,7 +100,10 @@ Object::Object(const char *fileName) {
 	vector<float2> vertUVCoords;    // total collection of uv coordinates
 	vector<float3> vertNormals;        // total collection of normals
 
+	vector<float3> colors;			// one per vertex, white where the v line has no color
+	vector<bool> hasColor;
 	vector<float3> triangleColors;
+	bool allColored = true;			// colors are only kept if every corner used has one
 
 	string line;
 	while (getline(file, line)) {
@@ -72,7 +121,12 @@ Object::Object(const char *fileName) {
 			float y = stof(yString);
 			float z = stof(zString);
 			vertices.emplace_back(x, y, z);
-			vertexColors.push_back(randColor());
+
+			// some exporters append a vertex color as red, green, blue in [0, 1]
+			float r, g, b;
+			bool colored = (bool) (lineStream >> r >> g >> b);
+			colors.push_back(colored ? float3(255 * b, 255 * g, 255 * r) : float3(255, 255, 255));
+			hasColor.push_back(colored);
 		}
 		if (type == "vt") {
 			string uString;
@@ -100,7 +154,7 @@ Object::Object(const char *fileName) {
 			vector<float2> faceUVs;
 			vector<float3> faceNormals;
 
-			vector<float3> faceVertexColors;        // TODO temp alsoo
+			vector<float3> faceVertexColors;
 
 			string faceGroup;
 			while (lineStream >> faceGroup) {
@@ -119,7 +173,8 @@ Object::Object(const char *fileName) {
 				} else {
 					faceNormals.emplace_back(0, 0, 1);
 				}
-				faceVertexColors.push_back(vertexColors[pointIndex]);    // TODO temp
+				faceVertexColors.push_back(colors[pointIndex]);
+				allColored = allColored && hasColor[pointIndex];
 			}
 			size_t sizeFace = faceVertices.size();
 			for (int i = 2; i < sizeFace; i++) {
@@ -140,6 +195,494 @@ Object::Object(const char *fileName) {
 		}
 	}
 	file.close();
+	if (allColored) {
+		vertexColors = std::move(triangleColors);
+	}
+	weldCorners(*this);
+	buildMeshlets();
+	optimizeMesh();
+}
+
+int Object::numVertices() const {
+	return quantized() ? (int) packedVertices.size() : (int) points.size();
+}
+
+bool Object::quantized() const {
+	return !packedVertices.empty();
+}
+
+float3 Object::vertexPosition(int v) const {
+	if (!quantized()) {
+		return points[v];
+	}
+	const uint16_t *q = packedVertices[v].position;
+	return {positionMin.x + positionStep.x * q[0], positionMin.y + positionStep.y * q[1],
+			positionMin.z + positionStep.z * q[2]};
+}
+
+// octahedral normals (Meyer et al.): the unit sphere is projected onto the octahedron |x| + |y| + |z| = 1, and the
+// lower half is folded out over the corners of the square so the whole sphere maps to [-1, 1]^2
+static float signNotZero(float x) {
+	return x >= 0 ? 1.0f : -1.0f;
+}
+
+float3 Object::vertexNormal(int v) const {
+	if (!quantized()) {
+		return normals[v];
+	}
+	float x = (float) packedVertices[v].normal[0] / 32767;
+	float y = (float) packedVertices[v].normal[1] / 32767;
+	float z = 1 - fabsf(x) - fabsf(y);
+	if (z < 0) {
+		float foldedX = (1 - fabsf(y)) * signNotZero(x);
+		y = (1 - fabsf(x)) * signNotZero(y);
+		x = foldedX;
+	}
+	float3 n(x, y, z);
+	n.normalize();
+	return n;
+}
+
+float2 Object::vertexUV(int v) const {
+	if (!quantized()) {
+		return uvCoords[v];
+	}
+	const uint16_t *q = packedVertices[v].uv;
+	return {uvMin.x + uvStep.x * q[0], uvMin.y + uvStep.y * q[1]};
+}
+
+void Object::quantize() {
+	if (quantized() || points.empty()) {
+		return;
+	}
+
+	float3 positionMax = points[0];
+	positionMin = points[0];
+	for (const float3 &p: points) {
+		positionMin = float3(min(positionMin.x, p.x), min(positionMin.y, p.y), min(positionMin.z, p.z));
+		positionMax = float3(max(positionMax.x, p.x), max(positionMax.y, p.y), max(positionMax.z, p.z));
+	}
+	positionStep = (positionMax - positionMin) / 65535;
+
+	float2 uvMax = uvCoords[0];
+	uvMin = uvCoords[0];
+	for (const float2 &uv: uvCoords) {
+		uvMin = float2(min(uvMin.x, uv.x), min(uvMin.y, uv.y));
+		uvMax = float2(max(uvMax.x, uv.x), max(uvMax.y, uv.y));
+	}
+	uvStep = float2((uvMax.x - uvMin.x) / 65535, (uvMax.y - uvMin.y) / 65535);
+
+	auto unorm = [](float value, float start, float step) {
+		return (uint16_t) (step > 0 ? clamp((int) lroundf((value - start) / step), 0, 65535) : 0);
+	};
+	auto snorm = [](float value) {
+		return (int16_t) lroundf(min(max(value, -1.0f), 1.0f) * 32767);
+	};
+
+	packedVertices.resize(points.size());
+	for (size_t v = 0; v < points.size(); v++) {
+		PackedVertex &packed = packedVertices[v];
+		const float3 &p = points[v];
+		packed.position[0] = unorm(p.x, positionMin.x, positionStep.x);
+		packed.position[1] = unorm(p.y, positionMin.y, positionStep.y);
+		packed.position[2] = unorm(p.z, positionMin.z, positionStep.z);
+		packed.uv[0] = unorm(uvCoords[v].x, uvMin.x, uvStep.x);
+		packed.uv[1] = unorm(uvCoords[v].y, uvMin.y, uvStep.y);
+
+		const float3 &n = normals[v];
+		float sum = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+		float x = sum > 0 ? n.x / sum : 0;
+		float y = sum > 0 ? n.y / sum : 0;
+		if (n.z < 0) {
+			float foldedX = (1 - fabsf(y)) * signNotZero(x);
+			y = (1 - fabsf(x)) * signNotZero(y);
+			x = foldedX;
+		}
+		packed.normal[0] = snorm(x);
+		packed.normal[1] = snorm(y);
+	}
+
+	// positions move by up to half a step, so the meshlet bounds grow to still contain them
+	float slack = length(positionStep) / 2;
+	for (Meshlet &m: meshlets) {
+		m.radius += slack;
+	}
+	boundsRadius += slack;
+
+	points = vector<float3>();
+	uvCoords = vector<float2>();
+	normals = vector<float3>();
+}
+
+// spreads the lower 10 bits of v out to every third bit, for morton codes
+static unsigned int spreadBits(unsigned int v) {
+	v &= 0x3FF;
+	v = (v | (v << 16)) & 0x030000FF;
+	v = (v | (v << 8)) & 0x0300F00F;
+	v = (v | (v << 4)) & 0x030C30C3;
+	v = (v | (v << 2)) & 0x09249249;
+	return v;
+}
+
+// greedily grows clusters across shared vertices, preferring triangles close to the cluster that face the same
+// way, merges small clusters into the one before them, then reorders the triangles so each meshlet is a contiguous
+// range
+void Object::buildMeshlets(int maxTriangles) {
+	meshlets.clear();
+	boundsCenter = float3();
+	boundsRadius = 0;
+	if (numTriangles == 0) {
+		return;
+	}
+	const float maxSpread = 0.8f;		// cosine of the widest normal spread allowed within a cluster
+
+	// object bounds, used to quantize triangle centroids
+	float3 boundsMin = points[0];
+	float3 boundsMax = points[0];
+	for (const float3 &p: points) {
+		boundsMin = float3(min(boundsMin.x, p.x), min(boundsMin.y, p.y), min(boundsMin.z, p.z));
+		boundsMax = float3(max(boundsMax.x, p.x), max(boundsMax.y, p.y), max(boundsMax.z, p.z));
+	}
+	boundsCenter = (boundsMin + boundsMax) / 2;
+	boundsRadius = 0;
+	for (const float3 &p: points) {
+		boundsRadius = max(boundsRadius, length(p - boundsCenter));
+	}
+	float3 extent = boundsMax - boundsMin;
+	float maxExtent = max(max(extent.x, extent.y), max(extent.z, 1e-6f));
+
+	// face normals, centroids, and a morton code for picking seeds in spatial order
+	vector<float3> faceNormals(numTriangles);
+	vector<float3> centroids(numTriangles);
+	vector<unsigned int> mortonCodes(numTriangles);
+	for (int i = 0; i < numTriangles; i++) {
+		const float3 &a = points[indices[3 * i]];
+		const float3 &b = points[indices[3 * i + 1]];
+		const float3 &c = points[indices[3 * i + 2]];
+		float3 n = cross(b - a, c - a);
+		float nLength = length(n);
+		faceNormals[i] = nLength > 0 ? n / nLength : float3();
+
+		centroids[i] = (a + b + c) / 3;
+		float3 q = (centroids[i] - boundsMin) * (1023 / maxExtent);
+		mortonCodes[i] = spreadBits((unsigned int) q.x) | spreadBits((unsigned int) q.y) << 1 |
+						 spreadBits((unsigned int) q.z) << 2;
+	}
+
+	// weld corners by position (vertices split by uv or normal seams still count as neighbours), then list the
+	// triangles touching each position
+	int numCorners = 3 * numTriangles;
+	vector<int> corners(numCorners);
+	for (int c = 0; c < numCorners; c++) {
+		corners[c] = c;
+	}
+	auto lessPosition = [this](int a, int b) {
+		const float3 &p = points[indices[a]];
+		const float3 &q = points[indices[b]];
+		return p.x != q.x ? p.x < q.x : (p.y != q.y ? p.y < q.y : p.z < q.z);
+	};
+	sort(corners.begin(), corners.end(), lessPosition);
+
+	vector<int> cornerVertex(numCorners);
+	int numVertices = 0;
+	for (int c = 0; c < numCorners; c++) {
+		if (c > 0 && lessPosition(corners[c - 1], corners[c])) {
+			numVertices++;
+		}
+		cornerVertex[corners[c]] = numVertices;
+	}
+	numVertices++;
+
+	vector<int> vertexStart(numVertices + 1, 0);
+	for (int c = 0; c < numCorners; c++) {
+		vertexStart[cornerVertex[c] + 1]++;
+	}
+	for (int v = 0; v < numVertices; v++) {
+		vertexStart[v + 1] += vertexStart[v];
+	}
+	vector<int> vertexTriangles(numCorners);
+	vector<int> fill(vertexStart.begin(), vertexStart.end() - 1);
+	for (int c = 0; c < numCorners; c++) {
+		vertexTriangles[fill[cornerVertex[c]]++] = c / 3;
+	}
+
+	vector<int> seeds(numTriangles);
+	for (int i = 0; i < numTriangles; i++) {
+		seeds[i] = i;
+	}
+	stable_sort(seeds.begin(), seeds.end(), [&mortonCodes](int a, int b) { return mortonCodes[a] < mortonCodes[b]; });
+
+	vector<int> order;			// triangles in meshlet order
+	order.reserve(numTriangles);
+	vector<char> assigned(numTriangles, false);
+	vector<int> frontier;
+	for (int seed: seeds) {
+		if (assigned[seed]) {
+			continue;
+		}
+
+		int first = (int) order.size();
+		float3 center = centroids[seed];
+		float3 normalSum = faceNormals[seed];
+		frontier.clear();
+
+		int next = seed;
+		while (next >= 0) {
+			assigned[next] = true;
+			order.push_back(next);
+			int count = (int) order.size() - first;
+			if (count == maxTriangles) {
+				break;
+			}
+			center = (center * (float) (count - 1) + centroids[next]) / (float) count;
+			if (next != seed) {
+				normalSum += faceNormals[next];
+			}
+			for (int k = 0; k < 3; k++) {
+				int v = cornerVertex[3 * next + k];
+				for (int t = vertexStart[v]; t < vertexStart[v + 1]; t++) {
+					if (!assigned[vertexTriangles[t]]) {
+						frontier.push_back(vertexTriangles[t]);
+					}
+				}
+			}
+
+			// take the nearest neighbour that keeps the cluster's normals within the allowed spread
+			float3 axis = length(normalSum) > 0 ? normalSum / length(normalSum) : float3();
+			next = -1;
+			float bestScore = 0;
+			for (size_t f = 0; f < frontier.size();) {
+				int candidate = frontier[f];
+				if (assigned[candidate]) {
+					frontier[f] = frontier.back();
+					frontier.pop_back();
+					continue;
+				}
+				float facing = dot(faceNormals[candidate], axis);
+				if (facing >= maxSpread) {
+					float score = length(centroids[candidate] - center) * (2 - facing);
+					if (next < 0 || score < bestScore) {
+						next = candidate;
+						bestScore = score;
+					}
+				}
+				f++;
+			}
+		}
+
+		// curved surfaces break into many small clusters under the normal limit, and tiny meshlets cost more to cull
+		// than they save. Seeds go in morton order, so the previous cluster is nearby and can take this one in
+		int count = (int) order.size() - first;
+		if (!meshlets.empty() && meshlets.back().numTriangles + count <= maxTriangles &&
+			min(meshlets.back().numTriangles, count) < maxTriangles / 2) {
+			meshlets.back().numTriangles += count;
+			continue;
+		}
+		Meshlet m{};
+		m.firstTriangle = first;
+		m.numTriangles = count;
+		meshlets.push_back(m);
+	}
+
+	// apply the new order to the triangles
+	vector<int> sorted(3 * numTriangles);
+	for (int i = 0; i < numTriangles; i++) {
+		for (int k = 0; k < 3; k++) {
+			sorted[3 * i + k] = indices[3 * order[i] + k];
+		}
+	}
+	indices = std::move(sorted);
+
+	// bounding spheres and normal cones
+	for (Meshlet &m: meshlets) {
+		int begin = 3 * m.firstTriangle;
+		int end = 3 * (m.firstTriangle + m.numTriangles);
+
+		float3 lo = points[indices[begin]];
+		float3 hi = points[indices[begin]];
+		for (int c = begin; c < end; c++) {
+			const float3 &p = points[indices[c]];
+			lo = float3(min(lo.x, p.x), min(lo.y, p.y), min(lo.z, p.z));
+			hi = float3(max(hi.x, p.x), max(hi.y, p.y), max(hi.z, p.z));
+		}
+		m.center = (lo + hi) / 2;
+		for (int c = begin; c < end; c++) {
+			m.radius = max(m.radius, length(points[indices[c]] - m.center));
+		}
+
+		float3 axis;
+		for (int i = m.firstTriangle; i < m.firstTriangle + m.numTriangles; i++) {
+			axis += faceNormals[order[i]];
+		}
+		float axisLength = length(axis);
+		m.coneCutoff = 2;
+		if (axisLength > 0) {
+			m.coneAxis = axis / axisLength;
+			float minCos = 1;
+			for (int i = m.firstTriangle; i < m.firstTriangle + m.numTriangles; i++) {
+				const float3 &n = faceNormals[order[i]];
+				if (dot(n, n) > 0) {
+					minCos = min(minCos, dot(n, m.coneAxis));
+				}
+			}
+			if (minCos > 0) {
+				m.coneCutoff = sqrtf(1 - minCos * minCos);
+			}
+
+			// back the apex off along the axis until it is behind every triangle's plane
+			float apexDistance = 0;
+			for (int i = m.firstTriangle; i < m.firstTriangle + m.numTriangles; i++) {
+				const float3 &n = faceNormals[order[i]];
+				float facing = dot(n, m.coneAxis);
+				if (facing > 0) {
+					apexDistance = max(apexDistance, dot(n, m.center - points[indices[3 * i]]) / facing);
+				}
+			}
+			m.coneApex = m.center - m.coneAxis * apexDistance;
+		}
+	}
+}
+
+// tipsify (Sander et al. 2007): fans out around one vertex at a time, moving on to whichever vertex just emitted will
+// still be in the cache when its remaining triangles are drawn. Appends the reordered triangles to out
+static void tipsify(const int *triangles, int count, int cacheSize, vector<int> &out) {
+	// number the vertices of this run of triangles locally
+	vector<int> vertices(triangles, triangles + 3 * count);
+	sort(vertices.begin(), vertices.end());
+	vertices.erase(unique(vertices.begin(), vertices.end()), vertices.end());
+	int numVertices = (int) vertices.size();
+	vector<int> local(3 * count);
+	for (int c = 0; c < 3 * count; c++) {
+		local[c] = (int) (lower_bound(vertices.begin(), vertices.end(), triangles[c]) - vertices.begin());
+	}
+
+	vector<int> live(numVertices, 0);
+	for (int v: local) {
+		live[v]++;
+	}
+	vector<int> adjacencyStart(numVertices + 1, 0);
+	for (int v = 0; v < numVertices; v++) {
+		adjacencyStart[v + 1] = adjacencyStart[v] + live[v];
+	}
+	vector<int> adjacency(3 * count);
+	vector<int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (int c = 0; c < 3 * count; c++) {
+		adjacency[fill[local[c]]++] = c / 3;
+	}
+
+	vector<int> cacheTime(numVertices, 0);
+	vector<char> emitted(count, false);
+	vector<int> deadEnd;
+	vector<int> candidates;
+	int time = cacheSize + 1;
+	int cursor = 0;
+	int fan = local[0];
+	while (fan >= 0) {
+		candidates.clear();
+		for (int a = adjacencyStart[fan]; a < adjacencyStart[fan + 1]; a++) {
+			int t = adjacency[a];
+			if (emitted[t]) {
+				continue;
+			}
+			emitted[t] = true;
+			for (int k = 0; k < 3; k++) {
+				int v = local[3 * t + k];
+				out.push_back(vertices[v]);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (time - cacheTime[v] > cacheSize) {
+					cacheTime[v] = time++;
+				}
+			}
+		}
+
+		// prefer the oldest candidate that will still be cached after its remaining triangles are added
+		fan = -1;
+		int bestPriority = -1;
+		for (int v: candidates) {
+			if (live[v] > 0) {
+				int priority = time - cacheTime[v] + 2 * live[v] <= cacheSize ? time - cacheTime[v] : 0;
+				if (priority > bestPriority) {
+					fan = v;
+					bestPriority = priority;
+				}
+			}
+		}
+
+		// otherwise go back to a recently used vertex, and failing that the next vertex with triangles left
+		while (fan < 0 && !deadEnd.empty()) {
+			int v = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[v] > 0) {
+				fan = v;
+			}
+		}
+		while (fan < 0 && cursor < numVertices) {
+			if (live[cursor] > 0) {
+				fan = cursor;
+			}
+			cursor++;
+		}
+	}
+}
+
+void Object::optimizeMesh(int cacheSize) {
+	if (numTriangles == 0) {
+		return;
+	}
+
+	// clusters facing away from the middle of the mesh tend to hide the ones behind them (Sander et al.), so those
+	// are drawn first and more of the later pixels fail the depth test
+	vector<int> meshletOrder(meshlets.size());
+	vector<float> occlusion(meshlets.size());
+	for (size_t m = 0; m < meshlets.size(); m++) {
+		meshletOrder[m] = (int) m;
+		occlusion[m] = meshlets[m].coneCutoff <= 1 ? dot(meshlets[m].center - boundsCenter, meshlets[m].coneAxis) : 0;
+	}
+	stable_sort(meshletOrder.begin(), meshletOrder.end(), [&occlusion](int a, int b) {
+		return occlusion[a] > occlusion[b];
+	});
+
+	// triangles stay inside their meshlet, so the bounds and cones are unchanged
+	vector<int> sorted;
+	sorted.reserve(indices.size());
+	vector<Meshlet> sortedMeshlets;
+	for (int m: meshletOrder) {
+		Meshlet meshlet = meshlets[m];
+		int first = (int) sorted.size() / 3;
+		tipsify(indices.data() + 3 * meshlet.firstTriangle, meshlet.numTriangles, cacheSize, sorted);
+		meshlet.firstTriangle = first;
+		sortedMeshlets.push_back(meshlet);
+	}
+	indices = std::move(sorted);
+	meshlets = std::move(sortedMeshlets);
+
+	// number vertices in the order they are first used, so vertex data is read front to back
+	vector<int> remap(points.size(), -1);
+	int numVertices = 0;
+	for (int &index: indices) {
+		if (remap[index] < 0) {
+			remap[index] = numVertices++;
+		}
+		index = remap[index];
+	}
+	auto reorder = [&remap, numVertices](auto &attribute) {
+		auto sortedAttribute = attribute;
+		sortedAttribute.resize(numVertices);
+		for (size_t v = 0; v < remap.size(); v++) {
+			if (remap[v] >= 0) {
+				sortedAttribute[remap[v]] = attribute[v];
+			}
+		}
+		attribute = std::move(sortedAttribute);
+	};
+	reorder(points);
+	reorder(uvCoords);
+	reorder(normals);
+	if (!vertexColors.empty()) {
+		reorder(vertexColors);
+	}
 }
 
 // parse an obj file into an object, splitting faces into triangles
@@ -244,12 +787,59 @@ Object parseObj(const char *fileName) {
 	return {numTriangles, points, uvCoords, normals, triangleColors};
 }
 
-Scene::Scene(vector<Object> objects) : objects(std::move(objects)), camera(Camera()) {}
+Scene::Scene(vector<Object> objects) : objects(std::move(objects)), ambient(float3(0.5f, 0.5f, 0.5f)),
+									   camera(Camera()) {
+	lights.push_back(Light::directional(float3(0, 0, 1), float3(0.5f, 0.5f, 0.5f)));
+}
+
+Light Light::directional(float3 direction, float3 color) {
+	direction.normalize();
+	return {LightType::Directional, float3(), direction, color, 0, 1, 1};
+}
+
+Light Light::point(float3 position, float3 color, float range) {
+	return {LightType::Point, position, float3(0, 0, 1), color, range, 1, 1};
+}
+
+Light Light::spot(float3 position, float3 direction, float3 color, float range, float innerAngle, float outerAngle) {
+	direction.normalize();
+	return {LightType::Spot, position, direction, color, range, cosf(innerAngle), cosf(outerAngle)};
+}
+
+float3 Light::illuminate(const float3 &p, const float3 &n) const {
+	if (type == LightType::Directional) {
+		return color * min(max(0.0f, -dot(n, direction)), 1.0f);
+	}
+
+	float3 toLight = position - p;
+	float distance = length(toLight);
+	if (distance >= range || distance == 0) {
+		return {};
+	}
+	toLight /= distance;
+
+	float falloff = 1 - distance / range;
+	float intensity = max(0.0f, dot(n, toLight)) * falloff * falloff;
+	if (type == LightType::Spot) {
+		float angle = -dot(toLight, direction);
+		float fade = outerCone < innerCone ? (angle - outerCone) / (innerCone - outerCone) : (float) (angle >= innerCone);
+		intensity *= min(max(0.0f, fade), 1.0f);
+	}
+	return color * intensity;
+}
 
 Texture::Texture(int width, int height, float3 **image) : width(width), height(height), image(image) {}
 
 Texture::Texture(const char *fileName) {
 	ifstream data(fileName, ios::binary);
+	char magic[4] = {0};
+	data.read(magic, 4);
+	if (memcmp(magic, "DDS ", 4) == 0) {
+		loadDDS(data);
+		return;
+	}
+
+	data.seekg(0);
 	data.ignore(10);
 	int pixelOffset;
 	data.read((char *) &pixelOffset, 4);
@@ -297,9 +887,147 @@ Texture::Texture() : width(20), height(20) {
 float3 Texture::sample(float2 uv) const {
 	int s = clamp((int) (uv.x * (float) (width - 1)), 0, width - 1);
 	int t = clamp((int) (uv.y * (float) (height - 1)), 0, height - 1);
+	if (format != TextureFormat::Uncompressed) {
+		return sampleCompressed(s, t);
+	}
 	return image[t][s];
 }
 
+// starts at 1 so a generation of 0 never matches an empty cache entry
+static atomic<uint64_t> nextBlockGeneration(1);
+
+// DDS stores block rows top down while image rows follow the BMP (bottom up), so rows are flipped in and out
+float3 Texture::sampleCompressed(int s, int t) const {
+	// decoded blocks are kept in a small direct mapped cache per thread, neighbouring pixels mostly hit the same block
+	// entries are keyed by generation rather than address, since freed block data can be reused by another texture
+	struct DecodedBlock {
+		uint64_t generation = 0;
+		int blockIndex = -1;
+		float3 texels[16];
+	};
+	thread_local DecodedBlock cache[256];
+
+	int y = height - 1 - t;
+	int blocksWide = (width + 3) / 4;
+	int blockIndex = (y / 4) * blocksWide + s / 4;
+
+	DecodedBlock &entry = cache[(blockIndex ^ (int) (blockGeneration * 97)) & 255];
+	if (entry.generation != blockGeneration || entry.blockIndex != blockIndex) {
+		const uint8_t *block = blocks->data() + (size_t) blockIndex * blockSize(format);
+		if (format == TextureFormat::BC1) {
+			decodeBC1Block(block, entry.texels);
+		} else {
+			decodeBC3Block(block, entry.texels);
+		}
+		entry.generation = blockGeneration;
+		entry.blockIndex = blockIndex;
+	}
+	return entry.texels[4 * (y % 4) + s % 4];
+}
+
+Texture Texture::compress(TextureFormat blockFormat) const {
+	Texture result(width, height, nullptr);
+	if (format != TextureFormat::Uncompressed || blockFormat == TextureFormat::Uncompressed) {
+		cerr << "Can only compress an uncompressed texture into a block format" << endl;
+		return *this;
+	}
+
+	int blocksWide = (width + 3) / 4;
+	int blocksHigh = (height + 3) / 4;
+	int size = blockSize(blockFormat);
+	auto data = make_shared<vector<uint8_t>>((size_t) blocksWide * blocksHigh * size);
+
+	for (int by = 0; by < blocksHigh; by++) {
+		for (int bx = 0; bx < blocksWide; bx++) {
+			// texels past the edge repeat the last row and column
+			float3 texels[16];
+			for (int j = 0; j < 4; j++) {
+				int y = min(4 * by + j, height - 1);
+				for (int i = 0; i < 4; i++) {
+					int x = min(4 * bx + i, width - 1);
+					texels[4 * j + i] = image[height - 1 - y][x];
+				}
+			}
+
+			uint8_t *block = data->data() + (size_t) (by * blocksWide + bx) * size;
+			if (blockFormat == TextureFormat::BC1) {
+				encodeBC1Block(texels, block);
+			} else {
+				encodeBC3Block(texels, block);
+			}
+		}
+	}
+
+	result.format = blockFormat;
+	result.blocks = data;
+	result.blockGeneration = nextBlockGeneration++;
+	return result;
+}
+
+void Texture::loadDDS(ifstream &data) {
+	// a truncated or corrupt file falls back to the default texture rather than leaving a short block buffer
+	uint32_t header[31];
+	data.read((char *) header, sizeof(header));
+	if (!data || header[0] != 124 || header[2] == 0 || header[3] == 0 || header[2] > 65536 || header[3] > 65536) {
+		cerr << "Malformed DDS header" << endl;
+		*this = Texture();
+		return;
+	}
+	height = (int) header[2];
+	width = (int) header[3];
+	uint32_t fourCC = header[20];
+
+	if (fourCC == 0x31545844) {				// "DXT1"
+		format = TextureFormat::BC1;
+	} else if (fourCC == 0x35545844) {		// "DXT5"
+		format = TextureFormat::BC3;
+	} else {
+		cerr << "Unsupported DDS format, only DXT1 and DXT5 can be read" << endl;
+		*this = Texture();
+		return;
+	}
+
+	size_t size = (size_t) ((width + 3) / 4) * ((height + 3) / 4) * blockSize(format);
+	auto blockData = make_shared<vector<uint8_t>>(size);
+	data.read((char *) blockData->data(), (streamsize) size);
+	if ((size_t) data.gcount() != size) {
+		cerr << "DDS file is missing block data for a " << width << "x" << height << " texture" << endl;
+		*this = Texture();
+		return;
+	}
+	image = nullptr;
+	blocks = blockData;
+	blockGeneration = nextBlockGeneration++;
+}
+
+bool Texture::saveDDS(const char *fileName) const {
+	if (format == TextureFormat::Uncompressed) {
+		cerr << "Only block compressed textures can be written to DDS" << endl;
+		return false;
+	}
+
+	uint32_t header[31] = {0};
+	header[0] = 124;								// header size
+	header[1] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x80000;	// caps, height, width, pixel format, linear size
+	header[2] = height;
+	header[3] = width;
+	header[4] = (uint32_t) blocks->size();			// linear size
+	header[18] = 32;								// pixel format size
+	header[19] = 0x4;								// four character code is set
+	header[20] = format == TextureFormat::BC1 ? 0x31545844 : 0x35545844;
+	header[26] = 0x1000;							// texture
+
+	ofstream file(fileName, ios::binary);
+	if (!file) {
+		cerr << "Could not open " << fileName << " for writing" << endl;
+		return false;
+	}
+	file.write("DDS ", 4);
+	file.write((const char *) header, sizeof(header));
+	file.write((const char *) blocks->data(), (streamsize) blocks->size());
+	return true;
+}
+
 Camera::Camera() : offset(float3()), rotation(Rotation()), fov(2*M_PI/3) {}
 
 Camera::Camera(float3 offset, Rotation rotation, float fov) : offset(offset), rotation(rotation), fov(fov) {}
@@ -11,7 +11,11 @@
 #include <string>
 #include <sstream>
 #include <cstdlib>
+#include <cstdint>
+#include <memory>
 #include "maths.h"
+#include "texcompress.h"
+#include "scenegraph.h"
 
 namespace nsGraphics {
 
@@ -19,39 +23,139 @@ namespace nsGraphics {
 	public:
 		int width;
 		int height;
-		float3 **image;
+		float3 **image;		// null for compressed textures
+		TextureFormat format = TextureFormat::Uncompressed;
+		std::shared_ptr<const std::vector<uint8_t>> blocks;		// compressed blocks, top row of blocks first
+		uint64_t blockGeneration = 0;	// new for every set of blocks, so cached decodes are never mistaken for another's
 
 		Texture(int width, int height, float3 **image);
 
-		Texture(const char *fileName);
+		Texture(const char *fileName);		// reads .bmp, or .dds files holding BC1/BC3 data
 
 		Texture();        // default constructor gives 100x100 with random colors
 
 		[[nodiscard]] float3 sample(float2 uv) const;
+
+		// returns a block compressed copy of an uncompressed texture
+		[[nodiscard]] Texture compress(TextureFormat blockFormat) const;
+
+		bool saveDDS(const char *fileName) const;
+
+	private:
+		void loadDDS(std::ifstream &data);
+
+		[[nodiscard]] float3 sampleCompressed(int s, int t) const;
+	};
+
+	// a run of nearby triangles with similar facing, so whole clusters can be culled at once
+	class Meshlet {
+	public:
+		int firstTriangle;
+		int numTriangles;
+		float3 center;		// bounding sphere in object space
+		float radius;
+		float3 coneApex;	// point behind the plane of every triangle in the meshlet
+		float3 coneAxis;	// average face normal
+		float coneCutoff;	// sine of the widest angle between a face normal and the axis, above 1 if it can't be culled
+	};
+
+	// vertex attributes in 14 bytes instead of 32: the position relative to the object's bounds, the normal folded
+	// onto an octahedron, and uvs relative to their range
+	class PackedVertex {
+	public:
+		uint16_t position[3];
+		int16_t normal[2];
+		uint16_t uv[2];
+	};
+
+	enum class ShadingMode {
+		Gouraud,	// lighting evaluated at the vertices and interpolated
+		PerPixel	// normals interpolated and lighting evaluated at every pixel
 	};
 
 	class Object {
 	public:
 		int numTriangles;
+		std::vector<int> indices;			// three per triangle, into the vertex attributes below
 		std::vector<float3> points;
 		std::vector<float2> uvCoords;
 		std::vector<float3> normals;
-		std::vector<float3> vertexColors;
+		std::vector<float3> vertexColors;	// empty if the mesh has no colors
+		std::vector<PackedVertex> packedVertices;	// replaces points, uvCoords and normals once quantized
+		float3 positionMin;					// decoding ranges for packed vertices
+		float3 positionStep;
+		float2 uvMin;
+		float2 uvStep;
+		std::vector<Meshlet> meshlets;
+		float3 boundsCenter;	// bounding sphere in object space
+		float boundsRadius;
 		Texture texture;
+		ShadingMode shading = ShadingMode::PerPixel;
 		float scale;
 		float3 offset;
 		Rotation rotation;
 
+		// attributes are given per corner, three per triangle, and corners that match exactly become one vertex
 		Object(int numTriangles, std::vector<float3> points, std::vector<float2> uvCoords, std::vector<float3> normals,
 			   std::vector<float3> vertexColors);
 
 		Object(const char *fileName);
 
 		[[nodiscard]] float3 localToWorld(const float3 &p) const;
+
+		[[nodiscard]] int numVertices() const;
+
+		[[nodiscard]] bool quantized() const;
+
+		// attributes of vertex v, decoded if the object is quantized
+		[[nodiscard]] float3 vertexPosition(int v) const;
+
+		[[nodiscard]] float3 vertexNormal(int v) const;
+
+		[[nodiscard]] float2 vertexUV(int v) const;
+
+		// packs the positions, normals and uvs into packedVertices and frees the float copies
+		void quantize();
+
+		// reorders the triangles into meshlets of at most maxTriangles, called by the constructors
+		void buildMeshlets(int maxTriangles = 64);
+
+		// reorders the triangles in each meshlet for vertex reuse in a cache of cacheSize, puts the meshlets most
+		// likely to hide the others first, then numbers the vertices in the order they are first used. Called by the
+		// constructors after buildMeshlets
+		void optimizeMesh(int cacheSize = 16);
 	};
 
 	Object parseObj(const char *fileName);
 
+	enum class LightType {
+		Directional,
+		Point,
+		Spot
+	};
+
+	class Light {
+	public:
+		LightType type;
+		float3 position;
+		float3 direction;		// direction the light travels, normalized
+		float3 color;			// scale applied per channel, in texture channel order (blue, green, red)
+		float range;			// point and spot lights fall off to nothing at this distance
+		float innerCone;		// cosine of the angle where a spot light starts to fade
+		float outerCone;		// cosine of the angle where a spot light is fully faded
+
+		static Light directional(float3 direction, float3 color);
+
+		static Light point(float3 position, float3 color, float range);
+
+		// cone angles are half angles in radians
+		static Light spot(float3 position, float3 direction, float3 color, float range, float innerAngle,
+						  float outerAngle);
+
+		// light reaching point p with normal n
+		[[nodiscard]] float3 illuminate(const float3 &p, const float3 &n) const;
+	};
+
 	class Camera {
 	public:
 		float3 offset;
@@ -66,9 +170,12 @@ namespace nsGraphics {
 	class Scene {
 	public:
 		std::vector<Object> objects;
+		SceneGraph graph;		// optional hierarchy driving the transforms of attached objects
+		std::vector<Light> lights;
+		float3 ambient;
 		Camera camera;
 
-		Scene(std::vector<Object> objects);
+		Scene(std::vector<Object> objects);		// starts with a single light shining straight into the screen
 	};
 
 }
@@ -0,0 +1,167 @@
+/*
+ * Author: Nate Shaffer
+ * Email: nshaffe4@u.rochester.edu
+ * Date Created: 10/18/2026
+ *
+ * Encoding and decoding of BC1 (DXT1) and BC3 (DXT5) texture blocks
+ */
+
+#include <algorithm>
+#include "texcompress.h"
+
+using namespace std;
+using namespace nsGraphics;
+
+int nsGraphics::blockSize(TextureFormat format) {
+	switch (format) {
+		case TextureFormat::BC1:
+			return 8;
+		case TextureFormat::BC3:
+			return 16;
+		default:
+			return 0;
+	}
+}
+
+// colors are handled as (red, green, blue) inside this file, Texture stores them the other way around
+static uint16_t packColor(float3 rgb) {
+	auto r = (uint16_t) clamp((int) (rgb.x * 31 / 255 + 0.5f), 0, 31);
+	auto g = (uint16_t) clamp((int) (rgb.y * 63 / 255 + 0.5f), 0, 63);
+	auto b = (uint16_t) clamp((int) (rgb.z * 31 / 255 + 0.5f), 0, 31);
+	return (uint16_t) (r << 11 | g << 5 | b);
+}
+
+static float3 unpackColor(uint16_t c) {
+	int r = (c >> 11) & 31;
+	int g = (c >> 5) & 63;
+	int b = c & 31;
+	return {(float) (r << 3 | r >> 2), (float) (g << 2 | g >> 4), (float) (b << 3 | b >> 2)};
+}
+
+// builds the four entry palette, or the three entry plus black palette BC1 uses when color0 <= color1
+static void makePalette(uint16_t c0, uint16_t c1, bool threeColorMode, float3 palette[4]) {
+	palette[0] = unpackColor(c0);
+	palette[1] = unpackColor(c1);
+	if (threeColorMode) {
+		palette[2] = (palette[0] + palette[1]) / 2;
+		palette[3] = float3();
+	} else {
+		palette[2] = (palette[0] * 2 + palette[1]) / 3;
+		palette[3] = (palette[0] + palette[1] * 2) / 3;
+	}
+}
+
+// fits endpoints along the principal axis of the block's colors and picks the closest palette entry per texel
+static void encodeColorBlock(const float3 texels[16], uint8_t *block) {
+	float3 colors[16];
+	float3 mean;
+	for (int i = 0; i < 16; i++) {
+		colors[i] = float3(texels[i].z, texels[i].y, texels[i].x);
+		mean += colors[i];
+	}
+	mean /= 16;
+
+	// covariance, then a few rounds of power iteration for the dominant direction
+	float cov[6] = {0};
+	for (const float3 &c: colors) {
+		float3 d = c - mean;
+		cov[0] += d.x * d.x; cov[1] += d.x * d.y; cov[2] += d.x * d.z;
+		cov[3] += d.y * d.y; cov[4] += d.y * d.z; cov[5] += d.z * d.z;
+	}
+	float3 axis(1, 1, 1);
+	for (int iter = 0; iter < 4; iter++) {
+		axis = float3(cov[0] * axis.x + cov[1] * axis.y + cov[2] * axis.z,
+					  cov[1] * axis.x + cov[3] * axis.y + cov[4] * axis.z,
+					  cov[2] * axis.x + cov[4] * axis.y + cov[5] * axis.z);
+		float axisLength = length(axis);
+		if (axisLength < 1e-6f) {
+			axis = float3();
+			break;
+		}
+		axis /= axisLength;
+	}
+
+	float3 minColor = colors[0];
+	float3 maxColor = colors[0];
+	float minProj = dot(colors[0] - mean, axis);
+	float maxProj = minProj;
+	for (const float3 &c: colors) {
+		float proj = dot(c - mean, axis);
+		if (proj < minProj) {
+			minProj = proj;
+			minColor = c;
+		}
+		if (proj > maxProj) {
+			maxProj = proj;
+			maxColor = c;
+		}
+	}
+
+	// pull the endpoints in slightly, the extremes are rarely the best fit for the interpolated entries
+	float3 inset = (maxColor - minColor) / 16;
+	uint16_t c0 = packColor(maxColor - inset);
+	uint16_t c1 = packColor(minColor + inset);
+	if (c0 < c1) {
+		swap(c0, c1);
+	}
+
+	uint32_t indices = 0;
+	if (c0 != c1) {
+		float3 palette[4];
+		makePalette(c0, c1, false, palette);
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			float bestDistance = dot(colors[i] - palette[0], colors[i] - palette[0]);
+			for (int p = 1; p < 4; p++) {
+				float distance = dot(colors[i] - palette[p], colors[i] - palette[p]);
+				if (distance < bestDistance) {
+					best = p;
+					bestDistance = distance;
+				}
+			}
+			indices |= (uint32_t) best << (2 * i);
+		}
+	}
+
+	block[0] = (uint8_t) (c0 & 0xFF);
+	block[1] = (uint8_t) (c0 >> 8);
+	block[2] = (uint8_t) (c1 & 0xFF);
+	block[3] = (uint8_t) (c1 >> 8);
+	for (int i = 0; i < 4; i++) {
+		block[4 + i] = (uint8_t) (indices >> (8 * i));
+	}
+}
+
+static void decodeColorBlock(const uint8_t *block, bool allowThreeColor, float3 texels[16]) {
+	auto c0 = (uint16_t) (block[0] | block[1] << 8);
+	auto c1 = (uint16_t) (block[2] | block[3] << 8);
+	uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | (uint32_t) block[7] << 24;
+
+	float3 palette[4];
+	makePalette(c0, c1, allowThreeColor && c0 <= c1, palette);
+	for (int i = 0; i < 16; i++) {
+		const float3 &c = palette[(indices >> (2 * i)) & 3];
+		texels[i] = float3(c.z, c.y, c.x);
+	}
+}
+
+void nsGraphics::encodeBC1Block(const float3 texels[16], uint8_t *block) {
+	encodeColorBlock(texels, block);
+}
+
+void nsGraphics::encodeBC3Block(const float3 texels[16], uint8_t *block) {
+	// both alpha endpoints at 255 with every index 0
+	block[0] = 255;
+	block[1] = 255;
+	fill(block + 2, block + 8, 0);
+	encodeColorBlock(texels, block + 8);
+}
+
+void nsGraphics::decodeBC1Block(const uint8_t *block, float3 texels[16]) {
+	decodeColorBlock(block, true, texels);
+}
+
+// the alpha half is skipped since textures only carry color
+void nsGraphics::decodeBC3Block(const uint8_t *block, float3 texels[16]) {
+	decodeColorBlock(block + 8, false, texels);
+}
@@ -0,0 +1,34 @@
+//
+// Created by nates on 10/18/2026.
+//
+
+#ifndef RENDERINGPROJECT_TEXCOMPRESS_H
+#define RENDERINGPROJECT_TEXCOMPRESS_H
+
+#include <cstdint>
+#include "maths.h"
+
+namespace nsGraphics {
+
+	// block compressed texture formats, each block holds 4x4 texels
+	enum class TextureFormat {
+		Uncompressed,
+		BC1,		// 8 bytes per block, two 565 endpoints and 2 bit indices
+		BC3			// 16 bytes per block, BC1 style color plus 8 bit alpha endpoints and 3 bit indices
+	};
+
+	int blockSize(TextureFormat format);
+
+	// texels are float3 colors in the same channel order as Texture (blue, green, red) in [0, 255], row major
+	void encodeBC1Block(const float3 texels[16], uint8_t *block);
+
+	// alpha is not tracked by Texture, so BC3 blocks are written fully opaque
+	void encodeBC3Block(const float3 texels[16], uint8_t *block);
+
+	void decodeBC1Block(const uint8_t *block, float3 texels[16]);
+
+	void decodeBC3Block(const uint8_t *block, float3 texels[16]);
+
+}
+
+#endif //RENDERINGPROJECT_TEXCOMPRESS_H
@@ -0,0 +1,52 @@
+/*
+ * Author: Nate Shaffer
+ * Email: nshaffe4@u.rochester.edu
+ * Date Created: 10/18/2026
+ *
+ * General purpose worker pool used for loading assets in the background
+ */
+
+#include <algorithm>
+#include "threadpool.h"
+
+using namespace std;
+using namespace nsGraphics;
+
+ThreadPool::ThreadPool(int numThreads) : stopping(false) {
+	for (int i = 0; i < max(1, numThreads); i++) {
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+// finishes every queued task before joining
+ThreadPool::~ThreadPool() {
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	taskReady.notify_all();
+	for (thread &worker: workers) {
+		worker.join();
+	}
+}
+
+int ThreadPool::size() const {
+	return (int) workers.size();
+}
+
+void ThreadPool::workerLoop() {
+	unique_lock<mutex> guard(lock);
+	while (true) {
+		taskReady.wait(guard, [this] { return stopping || !tasks.empty(); });
+		if (tasks.empty()) {
+			return;
+		}
+
+		function<void()> task = std::move(tasks.front());
+		tasks.pop_front();
+
+		guard.unlock();
+		task();
+		guard.lock();
+	}
+}
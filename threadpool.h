@@ -0,0 +1,55 @@
+//
+// Created by nates on 10/18/2026.
+//
+
+#ifndef RENDERINGPROJECT_THREADPOOL_H
+#define RENDERINGPROJECT_THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace nsGraphics {
+
+	// fixed set of worker threads pulling tasks off a shared FIFO queue
+	class ThreadPool {
+		std::vector<std::thread> workers;
+		std::deque<std::function<void()>> tasks;
+		std::mutex lock;
+		std::condition_variable taskReady;
+		bool stopping;
+
+		void workerLoop();
+
+	public:
+		explicit ThreadPool(int numThreads = (int) std::thread::hardware_concurrency());
+
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool &operator=(const ThreadPool &) = delete;
+
+		~ThreadPool();
+
+		[[nodiscard]] int size() const;
+
+		// runs f on a worker, the returned future holds its result (or the exception it threw)
+		template<class F>
+		auto submit(F f) -> std::future<decltype(f())> {
+			auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::move(f));
+			std::future<decltype(f())> result = task->get_future();
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				tasks.emplace_back([task] { (*task)(); });
+			}
+			taskReady.notify_one();
+			return result;
+		}
+	};
+
+}
+
+#endif //RENDERINGPROJECT_THREADPOOL_H
@@ -0,0 +1,60 @@
+//
+// Created by nates on 10/18/2026.
+//
+
+#ifndef RENDERINGPROJECT_TRIPLEBUFFER_H
+#define RENDERINGPROJECT_TRIPLEBUFFER_H
+
+#include <atomic>
+
+namespace nsGraphics {
+
+	// hands the latest value from one producer thread to one consumer thread without locking. The producer fills
+	// in back() and publishes it, the consumer calls update() and reads front(). Neither side ever waits: the
+	// producer always has a free slot, and the consumer keeps the last value it took until a newer one arrives.
+	// Values the consumer didn't get to in time are overwritten
+	template<class T>
+	class TripleBuffer {
+		static const int fresh = 4;			// set on the shared slot when it holds a value the consumer hasn't taken
+
+		T buffers[3];
+		alignas(64) std::atomic<int> shared;	// index of the slot between the two threads
+		alignas(64) int writing = 0;			// only touched by the producer
+		alignas(64) int reading = 2;			// only touched by the consumer
+
+	public:
+		// every slot is constructed from the same arguments
+		template<class... Args>
+		explicit TripleBuffer(const Args &... args) : buffers{T(args...), T(args...), T(args...)}, shared(1) {}
+
+		TripleBuffer(const TripleBuffer &) = delete;
+		TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+		// slot the producer writes the next value into
+		T &back() {
+			return buffers[writing];
+		}
+
+		// makes back() visible to the consumer, and hands the producer a different slot to write next
+		void publish() {
+			writing = shared.exchange(writing | fresh, std::memory_order_acq_rel) & 3;
+		}
+
+		// swaps in the most recently published value, false if nothing new has been published since the last call
+		bool update() {
+			if (!(shared.load(std::memory_order_relaxed) & fresh)) {
+				return false;
+			}
+			reading = shared.exchange(reading, std::memory_order_acq_rel) & 3;
+			return true;
+		}
+
+		// value taken by the last successful update
+		const T &front() const {
+			return buffers[reading];
+		}
+	};
+
+}
+
+#endif //RENDERINGPROJECT_TRIPLEBUFFER_H